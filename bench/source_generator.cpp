@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Shape of the generated source
+struct Options {
+    // Statements of all the sections together
+    int lines = 6000;
+    // Sections in the order .text, .data, .rodata, .bss
+    int sections = 4;
+    // Percent of the instructions behind a label
+    int labels = 10;
+    // Symbols exported by .global, the ones beyond the labels are external
+    int globals = 100;
+    // Percents of single address, double address and jump instructions
+    int single = 30;
+    int dual = 60;
+    int jumps = 10;
+    // Percent of the statements in data sections, and values per directive
+    int data = 20;
+    int values = 4;
+    unsigned seed = 1;
+};
+
+// Address space of the assembler, the sections have to fit into it
+static const int MEMORY_SIZE = 0x10000;
+// Largest instruction, with an operand word
+static const int INSTRUCTION_SIZE = 4;
+
+static const char* const CONDITIONS[] = {"", "eq", "ne", "gt", "al"};
+static const char* const SINGLE[] = {"push", "pop", "call"};
+static const char* const DUAL[] = {"add", "sub", "mul", "div", "cmp", "and",
+                                   "or",  "not", "test", "mov", "shl", "shr"};
+
+template <typename T, int N>
+static const T& pick(const T (&items)[N], std::mt19937& random) {
+    return items[random() % N];
+}
+
+static bool parse(int argc, char** argv, Options& options) {
+    for (auto i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (argument == "--help" || i + 1 == argc) {
+            return false;
+        }
+        string value = argv[++i];
+        if (argument == "--mix") {
+            std::istringstream mix(value);
+            char separator;
+            if (!(mix >> options.single >> separator >> options.dual >>
+                  separator >> options.jumps) ||
+                options.single < 0 || options.dual < 0 || options.jumps < 0 ||
+                options.single + options.dual + options.jumps == 0) {
+                return false;
+            }
+            continue;
+        }
+        auto number = std::atoi(value.c_str());
+        if (number < 0) {
+            return false;
+        }
+        if (argument == "--lines") {
+            options.lines = number;
+        } else if (argument == "--sections") {
+            options.sections = number;
+        } else if (argument == "--labels") {
+            options.labels = number;
+        } else if (argument == "--globals") {
+            options.globals = number;
+        } else if (argument == "--data") {
+            options.data = number;
+        } else if (argument == "--values") {
+            options.values = number;
+        } else if (argument == "--seed") {
+            options.seed = number;
+        } else {
+            return false;
+        }
+    }
+    return options.lines >= 1 && options.sections >= 1 &&
+           options.sections <= 4 && options.labels <= 100 &&
+           options.data <= 100 && options.values >= 1;
+}
+
+// Symbol a statement can reference, a label or an external symbol
+static string symbol(int labelCount, int externalCount, std::mt19937& random) {
+    auto index = random() % (labelCount + externalCount);
+    return index < unsigned(labelCount)
+               ? "L" + std::to_string(index)
+               : "EXT" + std::to_string(index - labelCount);
+}
+
+static string sourceOperand(int labelCount, int externalCount,
+                            std::mt19937& random) {
+    switch (random() % 6) {
+        case 0:
+            return "r" + std::to_string(random() % 8);
+        case 1:
+            return std::to_string(random() % 1000);
+        case 2:
+            return "r" + std::to_string(random() % 8) + "[" +
+                   std::to_string(random() % 16) + "]";
+        case 3:
+            return "&" + symbol(labelCount, externalCount, random);
+        case 4:
+            return "$" + symbol(labelCount, 0, random);
+        default:
+            return symbol(labelCount, externalCount, random);
+    }
+}
+
+// Writes valid source for the assembler with the given shape to stdout
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        cerr << "Usage: source_generator.out [--lines N] [--sections 1-4] "
+                "[--labels PERCENT] [--globals N] [--mix SINGLE:DOUBLE:JUMP] "
+                "[--data PERCENT] [--values N] [--seed N]"
+             << endl;
+        return -1;
+    }
+    std::mt19937 random(options.seed);
+
+    // Without data sections every statement is an instruction
+    auto dataLines =
+        options.sections > 1 ? options.lines * options.data / 100 : 0;
+    auto instructionLines = options.lines - dataLines;
+    auto labelCount = std::max(instructionLines * options.labels / 100, 1);
+    auto externalCount = std::max(options.globals - labelCount, 0);
+    auto dataSize = dataLines * (options.values * 4 + 1);
+    if (instructionLines * INSTRUCTION_SIZE + dataSize > MEMORY_SIZE) {
+        cerr << "Sections of up to " << instructionLines * INSTRUCTION_SIZE +
+                                            dataSize
+             << " bytes don't fit into " << MEMORY_SIZE << " bytes" << endl;
+        return -1;
+    }
+
+    std::ostringstream source;
+    for (auto i = 0; i < options.globals; i++) {
+        source << (i % 10 ? ", " : i ? "\n.global " : ".global ")
+               << (i < labelCount ? "L" + std::to_string(i)
+                                  : "EXT" + std::to_string(i - labelCount));
+    }
+    source << "\n.text\n";
+
+    // Labels are spread evenly, the first instruction always has one
+    auto label = 0;
+    auto mix = options.single + options.dual + options.jumps;
+    for (auto i = 0; i < instructionLines; i++) {
+        if (label < labelCount &&
+            i >= long(label) * instructionLines / labelCount) {
+            source << 'L' << label++ << ':';
+        }
+        source << "    ";
+        auto kind = int(random() % mix);
+        auto condition = pick(CONDITIONS, random);
+        if (kind < options.single) {
+            const string name = pick(SINGLE, random);
+            source << name << condition << ' ';
+            if (name == "call") {
+                source << symbol(labelCount, externalCount, random);
+            } else {
+                source << 'r' << random() % 8;
+            }
+        } else if (kind < options.single + options.dual) {
+            source << pick(DUAL, random) << condition << " r" << random() % 8
+                   << ", " << sourceOperand(labelCount, externalCount, random);
+        } else {
+            source << "jmp" << condition << ' '
+                   << (random() % 2 ? "$" : "")
+                   << symbol(labelCount, 0, random);
+        }
+        source << '\n';
+    }
+
+    // Data statements are split between the other sections
+    const char* const dataSections[] = {".data", ".rodata", ".bss"};
+    for (auto s = 1; s < options.sections; s++) {
+        source << dataSections[s - 1] << '\n';
+        auto first = dataLines * (s - 1) / (options.sections - 1);
+        auto last = dataLines * s / (options.sections - 1);
+        for (auto i = first; i < last; i++) {
+            if (s == 3) {
+                source << "    .skip " << options.values * 4 << '\n';
+                continue;
+            }
+            static const char* const directives[] = {".char", ".word",
+                                                     ".long"};
+            auto directive = random() % 3;
+            source << "    " << directives[directive];
+            for (auto v = 0; v < options.values; v++) {
+                source << (v ? ", " : " ");
+                // Words and longs can hold addresses
+                if (directive && random() % 4 == 0) {
+                    source << symbol(labelCount, externalCount, random);
+                } else {
+                    source << random() % 128;
+                }
+            }
+            source << '\n';
+            if (directive == 0) {
+                source << "    .align 2\n";
+            }
+        }
+    }
+    source << ".end\n";
+    cout << source.str();
+    return 0;
+}
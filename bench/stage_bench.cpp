@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "assembler.h"
+#include "data.h"
+#include "recognizer.h"
+#include "section.h"
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "token.h"
+#include "tokenizer.h"
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Runs the stages of one assembly of a source on their own, each as often
+// as needed for a stable time, and reports the best round per source line
+// and per MB of source
+class StageBench {
+   public:
+    explicit StageBench(const SourceBuffer& input)
+        : input(input),
+          lines(std::count(input.begin(), input.end(), '\n') +
+                (input.size() && input.end()[-1] != '\n')),
+          passes(assembler) {}
+
+    void run();
+
+   private:
+    static const int MIN_ROUNDS = 5;
+    static const int MAX_ROUNDS = 10000;
+    // Rounds are repeated until the stage took this long in total
+    static const double MIN_TIME;
+
+    // Best time of the stage, setup runs before every round untimed
+    template <typename Setup, typename Stage>
+    static double measure(Setup setup, Stage stage);
+
+    void report(const string& stage, double seconds) const;
+
+    // Fresh stream over the tokens, as the tokenizer leaves them
+    void rewind();
+
+    const SourceBuffer& input;
+    std::size_t lines;
+    Assembler assembler;
+    Assembler::Passes passes;
+    Recognizer recognizer;
+    unique_ptr<StringInterner> interner;
+    vector<Token> tokens;
+    unique_ptr<TokenStream> tokenStream;
+};
+
+const double StageBench::MIN_TIME = 0.2;
+
+template <typename Setup, typename Stage>
+double StageBench::measure(Setup setup, Stage stage) {
+    auto best = std::numeric_limits<double>::max();
+    auto total = 0.0;
+    for (auto round = 0;
+         round < MIN_ROUNDS || (total < MIN_TIME && round < MAX_ROUNDS);
+         round++) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        total += elapsed.count();
+    }
+    return best;
+}
+
+void StageBench::report(const string& stage, double seconds) const {
+    cout << std::left << std::setw(30) << stage << std::right << std::fixed
+         << std::setprecision(1) << std::setw(10) << seconds * 1e9 / lines
+         << " ns/line" << std::setw(10)
+         << input.size() / seconds / (1 << 20) << " MB/s" << endl;
+}
+
+void StageBench::rewind() {
+    tokenStream.reset(new TokenStream(vector<Token>(tokens)));
+}
+
+void StageBench::run() {
+    cout << lines << " lines, " << input.size() << " bytes" << endl;
+
+    // Interning into a fresh interner is part of tokenizing
+    report("Tokenizer::parse",
+           measure([this] { interner.reset(new StringInterner()); },
+                   [this] { tokens = Tokenizer(*interner).parse(input); }));
+
+    report("Recognizer::recognizeCommand",
+           measure([this] { rewind(); },
+                   [this] {
+                       auto& stream = *tokenStream;
+                       while (true) {
+                           while (!stream.end() &&
+                                  stream.peek().getType() ==
+                                      Token::LINE_DELIMITER) {
+                               stream.next();
+                           }
+                           if (stream.end()) {
+                               break;
+                           }
+                           // Operands are skipped, a label can be followed
+                           // by a command on its line
+                           auto command = recognizer.recognizeCommand(stream);
+                           if (command.type == Command::LABEL) {
+                               continue;
+                           }
+                           while (stream.next().getType() !=
+                                  Token::LINE_DELIMITER) {
+                           }
+                       }
+                   }));
+
+    auto decodePass = [this] { passes.decode(*tokenStream, 0, *interner); };
+    report("Assembler::decode", measure([this] { rewind(); }, decodePass));
+
+    report("Assembler::backpatch",
+           measure(
+               [this, &decodePass] {
+                   rewind();
+                   decodePass();
+               },
+               [this] { passes.backpatch(); }));
+
+    std::ostringstream output;
+    report("Section::writeContent",
+           measure([&output] { output.str(""); },
+                   [this, &output] {
+                       for (auto&& s : passes.getSections()) {
+                           s->writeContent(output);
+                       }
+                   }));
+}
+
+// Stage throughput over a source file, e.g. one of source_generator.out
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        cout << "Usage: stage_bench.out SOURCE_FILE" << endl;
+        return -1;
+    }
+    try {
+        SourceBuffer input(argv[1]);
+        // Times per line and per byte mean nothing without any
+        if (!input.size()) {
+            cout << "Source file " << argv[1] << " is empty" << endl;
+            return -1;
+        }
+        StageBench(input).run();
+    } catch (const AssemblerException& e) {
+        cout << e.error() << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "tokenizer.h"
+using std::cout;
+using std::endl;
+using std::string;
+
+// Tokenizer throughput over the given sources, repeated up to a few MB
+int main(int argc, char** argv) {
+    const std::size_t targetSize = 16 << 20;
+    const int rounds = 5;
+
+    string sample;
+    for (auto i = 1; i < argc; i++) {
+        std::ifstream file(argv[i]);
+        std::stringstream content;
+        content << file.rdbuf();
+        sample += content.str() + "\n";
+    }
+    if (sample.empty()) {
+        cout << "Usage: tokenizer_bench.out SOURCE_FILE..." << endl;
+        return -1;
+    }
+    std::stringstream source;
+    for (std::size_t size = 0; size < targetSize; size += sample.size()) {
+        source << sample;
+    }
+    SourceBuffer input(source);
+
+    auto best = 0.0;
+    std::size_t tokenCount = 0;
+    for (auto i = 0; i < rounds; i++) {
+        StringInterner interner;
+        Tokenizer tokenizer(interner);
+        auto start = std::chrono::steady_clock::now();
+        tokenCount = tokenizer.parse(input).size();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        auto throughput = input.size() / elapsed.count() / (1 << 20);
+        best = throughput > best ? throughput : best;
+    }
+
+    cout << "Tokenizer::parse: " << (input.size() >> 20) << " MB, "
+         << tokenCount << " tokens, " << best << " MB/s" << endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "arena.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+const std::size_t Arena::BLOCK_SIZE = 0x10000;
+
+void Arena::clear() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    destructors.clear();
+}
+
+void Arena::reset() {
+    clear();
+    largeBlocks.clear();
+    current = nullptr;
+    remaining = 0;
+    usedBlocks = 0;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+    auto padding =
+        -reinterpret_cast<std::uintptr_t>(current) & (alignment - 1);
+    if (padding + size > remaining) {
+        // Oversized objects get a block of their own, the current block
+        // keeps serving the smaller ones
+        if (size + alignment > BLOCK_SIZE) {
+            largeBlocks.push_back(
+                std::unique_ptr<char[]>(new char[size + alignment]));
+            auto block = largeBlocks.back().get();
+            return block +
+                   (-reinterpret_cast<std::uintptr_t>(block) & (alignment - 1));
+        }
+        if (usedBlocks == blocks.size()) {
+            blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));
+        }
+        current = blocks[usedBlocks++].get();
+        remaining = BLOCK_SIZE;
+        padding = -reinterpret_cast<std::uintptr_t>(current) & (alignment - 1);
+    }
+    auto address = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    return address;
+}
@@ -1,17 +1,30 @@
 #include "assembler.h"
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
+#include "arena.h"
 #include "data.h"
 #include "exceptions_a.h"
+#include "header_cache.h"
 #include "instruction.h"
+#include "object_file.h"
 #include "recognizer.h"
 #include "section.h"
+#include "section_cache.h"
+#include "source_buffer.h"
+#include "string_interner.h"
 #include "symbol_table.h"
+#include "thread_pool.h"
 #include "tokenizer.h"
 using std::cout;
-using std::ifstream;
+using std::future;
 using std::ofstream;
 using std::ostream;
 using std::string;
@@ -20,9 +33,24 @@ using std::vector;
 // Address space size is 2^16
 const int Assembler::MEMORY_SIZE = 0x10000;
 
+// Inputs from this size up are tokenized on a pool while being decoded
+const std::size_t Assembler::PARALLEL_TOKENIZING_SIZE = 0x100000;
+
+// Files with at least this many fixups are backpatched in parallel
+const std::size_t Assembler::PARALLEL_BACKPATCHING_SIZE = 0x1000;
+
 void Assembler::assembleFile(const string& inputFileName,
                              const string& outputFileName,
-                             int startAddress) const {
+                             int startAddress, OutputFormat format) const {
+    Arena arena;
+    assembleFile(inputFileName, outputFileName, startAddress, arena, format);
+}
+
+void Assembler::assembleFile(const string& inputFileName,
+                             const string& outputFileName, int startAddress,
+                             Arena& arena, OutputFormat format) const {
+    arena.reset();
+
     // Memory guard
     if (startAddress > MEMORY_SIZE || startAddress < 0) {
         throw MemoryException("Invalid start address " +
@@ -30,15 +58,25 @@ void Assembler::assembleFile(const string& inputFileName,
     }
 
     // Formatting input
-    ifstream input;
-    input.exceptions(ifstream::badbit);
-    input.open(inputFileName.c_str());
-    Tokenizer tokenizer;
-    auto tokenStream = TokenStream(tokenizer.parse(input));
-    input.close();
+    SourceBuffer input(inputFileName);
+    StringInterner interner;
+    Tokenizer tokenizer(interner);
+    // Keeps the included files the tokens reference until the end
+    Includer includer(headers, interner);
+
+    // Sections kept by a previous assembly of the same file
+    SectionCache* cache = nullptr;
+    if (!cacheDirectory.empty() && inputFileName != SourceBuffer::STDIN_NAME) {
+        cache = arena.create<SectionCache>(cacheDirectory, inputFileName);
+    }
 
-    // First pass
-    auto symbolTable = firstPass(tokenStream, startAddress);
+    // Single pass over the source, the arena owns everything decoded
+    vector<Section*> sections;
+    vector<Fixup> fixups;
+    vector<CachedSection> cachedSections;
+    auto symbolTable =
+        decode(tokenizer, input, includer, startAddress, interner, arena,
+               sections, fixups, cache, cachedSections);
 
     // Memory guard
     if (symbolTable.getCummulativeSectionSize() + startAddress > MEMORY_SIZE) {
@@ -46,42 +84,95 @@ void Assembler::assembleFile(const string& inputFileName,
                               Utils::convertToString(startAddress));
     }
 
-    // Second pass
-    tokenStream.reset();
-    auto sections = secondPass(tokenStream, startAddress, symbolTable);
+    // Resolving symbol references
+    backpatch(fixups, symbolTable);
 
     for (auto&& s : sections) {
-        symbolTable.updateRelocationSectionSize(s->getName(),
+        symbolTable.updateRelocationSectionSize(s->getId(),
                                                 s->getRelocationSectionSize());
     }
 
     // Writing to output
     ofstream output;
-    output.open(outputFileName.c_str());
-    output << symbolTable;
-    write(sections, output);
+    if (format == BINARY) {
+        output.open(outputFileName.c_str(), ofstream::binary);
+        ObjectFile::write(output, symbolTable, sections);
+    } else {
+        output.open(outputFileName.c_str());
+        output << symbolTable;
+        write(sections, output);
+    }
     output.close();
 
-    // Dumping memory
-    for (auto&& s : sections) {
-        delete s;
+    if (cache) {
+        store(*cache, cachedSections, symbolTable, interner);
+    }
+}
+
+vector<Token> Assembler::tokenize(const Tokenizer& tokenizer,
+                                  const SourceBuffer& input) const {
+    if (input.size() < PARALLEL_TOKENIZING_SIZE ||
+        std::thread::hardware_concurrency() < 2 || ThreadPool::onWorker()) {
+        return tokenizer.parse(input);
     }
+    ThreadPool pool;
+    return tokenizer.parse(input, pool);
 }
 
-SymbolTable Assembler::firstPass(TokenStream& tokenStream,
-                                 int startAddress) const {
-    SymbolTable symbolTable;
+SymbolTable Assembler::decode(const Tokenizer& tokenizer,
+                              const SourceBuffer& input, Includer& includer,
+                              int startAddress,
+                              const StringInterner& interner, Arena& arena,
+                              vector<Section*>& sections,
+                              vector<Fixup>& fixups, SectionCache* cache,
+                              vector<CachedSection>& cachedSections) const {
+    if (cache || input.size() < PARALLEL_TOKENIZING_SIZE ||
+        ThreadPool::onWorker()) {
+        auto tokens = tokenize(tokenizer, input);
+        includer.expand(tokens);
+        // Cached sections reference the tokens until they are stored
+        auto tokenStream = arena.create<TokenStream>(std::move(tokens));
+        auto symbolTable = decode(*tokenStream, startAddress, interner, arena,
+                                  sections, fixups, cache, cachedSections);
+        splice(cachedSections, *tokenStream, symbolTable, interner, arena,
+               fixups);
+        return symbolTable;
+    }
+
+    ThreadPool pool;
+    Tokenizer::Pipeline pipeline(tokenizer, input, pool);
+    Includer::Source source(includer, pipeline);
+    TokenStream tokenStream(source);
+    try {
+        auto symbolTable = decode(tokenStream, startAddress, interner, arena,
+                                  sections, fixups, nullptr, cachedSections);
+        pipeline.finish();
+        return symbolTable;
+    } catch (...) {
+        // An invalid line is reported before any decoding error, as if the
+        // whole input was tokenized first
+        pipeline.finish();
+        throw;
+    }
+}
+
+SymbolTable Assembler::decode(TokenStream& tokenStream, int startAddress,
+                              const StringInterner& interner, Arena& arena,
+                              vector<Section*>& sections,
+                              vector<Fixup>& fixups, SectionCache* cache,
+                              vector<CachedSection>& cachedSections) const {
+    SymbolTable symbolTable(interner);
     auto locationCounter = startAddress;
     auto previousCommand = DUMMY_COMMAND;
     Section* currentSection = nullptr;
-    vector<string> globalSymbols;
+    vector<int> globalSymbols;
     auto endDetected = false;
 
     while (!tokenStream.end() && !endDetected) {
         auto command = recognizer.recognizeCommand(tokenStream);
         if (!isSequenceValid(previousCommand, command)) {
-            throw InvalidInstructionSequence(previousCommand.name,
-                                             command.name);
+            throw InvalidInstructionSequence(previousCommand.name.str(),
+                                             command.name.str());
         }
         if (currentSection && !isValidForSection(command, *currentSection)) {
             throw DecodingException("Invalid command " + command.name +
@@ -97,61 +188,50 @@ SymbolTable Assembler::firstPass(TokenStream& tokenStream,
             }
             case Command::END_DIR:
                 if (currentSection == nullptr) {
-                    throw NoSectionDefined(command.name);
+                    throw NoSectionDefined(command.name.str());
                 }
                 symbolTable.updateSectionSize(
-                    currentSection->getName(),
+                    currentSection->getId(),
                     locationCounter - symbolTable.getCummulativeSectionSize() -
                         startAddress);
-                delete currentSection;
                 endDetected = true;
                 break;
             case Command::SECTION:
                 if (currentSection) {
                     symbolTable.updateSectionSize(
-                        currentSection->getName(),
+                        currentSection->getId(),
                         locationCounter -
                             symbolTable.getCummulativeSectionSize() -
                             startAddress);
-                    delete currentSection;
                 }
                 currentSection = recognizer.recognizeSection(
-                    command, tokenStream, locationCounter);
-                symbolTable.putSection(currentSection->getName(),
+                    command, tokenStream, locationCounter, arena);
+                sections.push_back(currentSection);
+                symbolTable.putSection(currentSection->getId(),
                                        locationCounter);
+                if (cache && reuse(*cache, tokenStream, currentSection,
+                                   locationCounter, symbolTable, interner,
+                                   cachedSections)) {
+                    locationCounter += cachedSections.back().entry->size;
+                }
                 break;
             case Command::LABEL:
-                symbolTable.putSymbol(command.name, locationCounter);
-                break;
-            case Command::DEFINITION:
-                locationCounter += recognizer.recognizeDefinition(command)
-                                       .decode(tokenStream)
-                                       .getSize() /
-                                   8;
-                break;
-            case Command::ALIGN_DIR:
-                locationCounter += AlignDirective()
-                                       .decode(tokenStream)
-                                       .evaluate(locationCounter)
-                                       .getSize() /
-                                   8;
-                break;
-
-            case Command::SKIP_DIR:
-                locationCounter +=
-                    SkipDirective().decode(tokenStream).getSize() / 8;
-                break;
-            case Command::INSTRUCTION: {
-                auto instruction = recognizer.recognizeInstruction(command);
-                locationCounter +=
-                    instruction->decode(tokenStream).getSize() / 8;
-                delete instruction;
+                symbolTable.putSymbol(command.id, locationCounter);
                 break;
-            }
             default:
-                throw SystemException("Unknown command type " + command.name);
+                locationCounter += decodeStatement(
+                    command, tokenStream, currentSection, locationCounter,
+                    arena, fixups);
+                break;
         }
         previousCommand = command;
+
+        // Checked as the sections grow, so an oversized input stops early
+        if (locationCounter > MEMORY_SIZE) {
+            throw MemoryException(
+                "Sections are too big to start at the address " +
+                Utils::convertToString(startAddress));
+        }
     }
 
     if (!endDetected) {
@@ -170,6 +250,262 @@ SymbolTable Assembler::firstPass(TokenStream& tokenStream,
     return symbolTable;
 }
 
+template <typename T>
+int Assembler::decodeInstruction(
+    const Isa::InstructionSpecification& specification,
+    TokenStream& tokenStream, Section* section, int locationCounter,
+    Arena& arena, vector<Fixup>& fixups) const {
+    T instruction(specification);
+    instruction.decode(tokenStream);
+    return place(Fixup::INSTRUCTION, instruction, section, locationCounter,
+                 arena, fixups);
+}
+
+template <typename T>
+int Assembler::place(Fixup::Type type, T& statement, Section* section,
+                     int location, Arena& arena,
+                     vector<Fixup>& fixups) const {
+    auto size = statement.getSize() / 8;
+    auto offset = section->addContent(statement);
+    if (statement.referencesSymbols()) {
+        fixups.push_back(Fixup(type, arena.create<T>(std::move(statement)),
+                               section, location, offset));
+    }
+    return size;
+}
+
+int Assembler::decodeStatement(const Command& command,
+                               TokenStream& tokenStream, Section* section,
+                               int locationCounter, Arena& arena,
+                               vector<Fixup>& fixups) const {
+    switch (command.type) {
+        case Command::DEFINITION: {
+            auto definition = recognizer.recognizeDefinition(command);
+            definition.decode(tokenStream);
+            return place(Fixup::DEFINITION, definition, section,
+                         locationCounter, arena, fixups);
+        }
+        case Command::ALIGN_DIR: {
+            AlignDirective alignDir;
+            alignDir.decode(tokenStream).evaluate(locationCounter);
+            section->addFill(alignDir.getFill(), alignDir.getSize() / 8);
+            return alignDir.getSize() / 8;
+        }
+        case Command::SKIP_DIR: {
+            SkipDirective skipDir;
+            skipDir.decode(tokenStream);
+            section->addFill(skipDir.getFill(), skipDir.getSize() / 8);
+            return skipDir.getSize() / 8;
+        }
+        case Command::STRING_DIR: {
+            auto stringDir = recognizer.recognizeString(command);
+            stringDir.decode(tokenStream);
+            section->addContent(stringDir);
+            return stringDir.getSize() / 8;
+        }
+        case Command::INCBIN_DIR: {
+            IncbinDirective incbinDir;
+            incbinDir.decode(tokenStream);
+            // Mapped for the rest of the assembly, the section references
+            // the bytes until they are written
+            auto file = arena.create<SourceBuffer>(incbinDir.getFileName());
+            incbinDir.evaluate(file->size());
+            if (incbinDir.getLength() > std::size_t(MEMORY_SIZE)) {
+                throw MemoryException("Included file " +
+                                      incbinDir.getFileName() +
+                                      " is too big");
+            }
+            section->addExternal(reinterpret_cast<const unsigned char*>(
+                                     file->begin() + incbinDir.getOffset()),
+                                 incbinDir.getLength());
+            return incbinDir.getLength();
+        }
+        case Command::INSTRUCTION: {
+            const auto& specification =
+                recognizer.recognizeInstruction(command);
+            switch (specification.family) {
+                case Isa::SINGLE_ADDRESS:
+                    return decodeInstruction<SingleAddressInstruction>(
+                        specification, tokenStream, section, locationCounter,
+                        arena, fixups);
+                case Isa::DOUBLE_ADDRESS:
+                    return decodeInstruction<DoubleAddressInstruction>(
+                        specification, tokenStream, section, locationCounter,
+                        arena, fixups);
+                case Isa::NO_ADDRESS:
+                    return decodeInstruction<NoAddressInstruction>(
+                        specification, tokenStream, section, locationCounter,
+                        arena, fixups);
+                case Isa::RET:
+                    return decodeInstruction<RetInstruction>(
+                        specification, tokenStream, section, locationCounter,
+                        arena, fixups);
+                case Isa::JMP:
+                    return decodeInstruction<JmpInstruction>(
+                        specification, tokenStream, section, locationCounter,
+                        arena, fixups);
+            }
+            throw SystemException("No instruction found with name " +
+                                  command.name);
+        }
+        default:
+            throw SystemException("Unknown command type " + command.name);
+    }
+}
+
+bool Assembler::reuse(const SectionCache& cache, TokenStream& tokenStream,
+                      Section* section, int address, SymbolTable& symbolTable,
+                      const StringInterner& interner,
+                      vector<CachedSection>& cachedSections) const {
+    auto begin = tokenStream.position();
+    auto end = recognizer.findSectionEnd(begin, tokenStream.endPosition());
+
+    // A label closing the section may be followed by another one on the
+    // line of the next section, which only decoding reports as an error
+    auto last = end;
+    while (last != begin && (last - 1)->getType() == Token::LINE_DELIMITER) {
+        --last;
+    }
+    if (last != begin && (last - 1)->getType() == Token::LABEL) {
+        return false;
+    }
+
+    auto key = SectionCache::hash(section->getName(), address, begin, end);
+    auto entry = cache.find(key);
+    if (entry) {
+        for (auto&& l : entry->labels) {
+            if (interner.find(l.name) == StringInterner::NO_ID) {
+                entry = nullptr;
+                break;
+            }
+        }
+    }
+    cachedSections.push_back(
+        CachedSection(section, begin, end, address, key, entry));
+    if (!entry) {
+        return false;
+    }
+
+    for (auto&& l : entry->labels) {
+        symbolTable.putSymbol(interner.find(l.name), address + l.offset);
+    }
+    tokenStream.seek(end);
+    return true;
+}
+
+void Assembler::splice(const vector<CachedSection>& cachedSections,
+                       TokenStream& tokenStream,
+                       const SymbolTable& symbolTable,
+                       const StringInterner& interner, Arena& arena,
+                       vector<Fixup>& fixups) const {
+    auto decoded = false;
+    for (auto&& cs : cachedSections) {
+        if (!cs.entry) {
+            continue;
+        }
+        if (isCurrent(*cs.entry, *cs.section, symbolTable, interner)) {
+            cs.section->setContent(cs.entry->content, cs.entry->runs);
+            cs.section->addRelocationData(cs.entry->relocations);
+            continue;
+        }
+
+        // Referenced symbols changed, its labels are already defined
+        tokenStream.seek(cs.begin);
+        auto locationCounter = cs.address;
+        while (true) {
+            while (tokenStream.position() != cs.end &&
+                   tokenStream.peek().getType() == Token::LINE_DELIMITER) {
+                tokenStream.next();
+            }
+            if (tokenStream.position() == cs.end) {
+                break;
+            }
+            auto command = recognizer.recognizeCommand(tokenStream);
+            if (command.type != Command::LABEL) {
+                locationCounter +=
+                    decodeStatement(command, tokenStream, cs.section,
+                                    locationCounter, arena, fixups);
+            }
+        }
+        decoded = true;
+    }
+
+    // Backpatching expects fixups in source order, which is address order
+    if (decoded) {
+        std::stable_sort(fixups.begin(), fixups.end(),
+                         [](const Fixup& first, const Fixup& second) {
+                             return first.location < second.location;
+                         });
+    }
+}
+
+bool Assembler::isCurrent(const SectionCache::Entry& entry,
+                          const Section& section,
+                          const SymbolTable& symbolTable,
+                          const StringInterner& interner) const {
+    if (symbolTable.getSection(section.getId()).number !=
+        entry.sectionNumber) {
+        return false;
+    }
+    for (auto&& d : entry.dependencies) {
+        auto id = interner.find(d.name);
+        if (id == StringInterner::NO_ID || !symbolTable.symbolExists(id)) {
+            return false;
+        }
+        const auto& symbol = symbolTable.getSymbol(id);
+        if (symbol.address != d.address || symbol.section != d.section ||
+            symbol.scope != SymbolTable::Scope(d.scope) ||
+            symbol.number != d.number) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Assembler::store(SectionCache& cache,
+                      const vector<CachedSection>& cachedSections,
+                      const SymbolTable& symbolTable,
+                      const StringInterner& interner) const {
+    for (auto&& cs : cachedSections) {
+        // Included files can change without the tokens changing
+        if (cs.section->hasExternalRuns()) {
+            continue;
+        }
+        SectionCache::Entry entry;
+        entry.key = cs.key;
+        entry.address = cs.address;
+        const auto& tableSection = symbolTable.getSection(cs.section->getId());
+        entry.size = tableSection.size;
+        entry.sectionNumber = tableSection.number;
+        vector<int> dependencies;
+        for (auto t = cs.begin; t != cs.end; ++t) {
+            auto id = t->getId();
+            if (t->getType() == Token::LABEL) {
+                entry.labels.push_back(SectionCache::Label{
+                    interner.getName(id),
+                    symbolTable.getSymbol(id).address - cs.address});
+            } else if (id != Token::NO_ID && symbolTable.symbolExists(id)) {
+                dependencies.push_back(id);
+            }
+        }
+        std::sort(dependencies.begin(), dependencies.end());
+        dependencies.erase(
+            std::unique(dependencies.begin(), dependencies.end()),
+            dependencies.end());
+        for (auto&& id : dependencies) {
+            const auto& symbol = symbolTable.getSymbol(id);
+            entry.dependencies.push_back(SectionCache::Dependency{
+                symbol.name, symbol.address, symbol.section,
+                std::uint32_t(symbol.scope), symbol.number});
+        }
+        entry.content = cs.section->getContent();
+        entry.runs = cs.section->getRuns();
+        entry.relocations = cs.section->getRelocations();
+        cache.put(entry);
+    }
+    cache.save();
+}
+
 bool Assembler::isSequenceValid(const Command& previousCommand,
                                 const Command& currentCommand) const {
     // Global directive can only be found at the beginning of a file
@@ -189,6 +525,8 @@ bool Assembler::isSequenceValid(const Command& previousCommand,
     if ((currentCommand.type == Command::INSTRUCTION ||
          currentCommand.type == Command::DEFINITION ||
          currentCommand.type == Command::SKIP_DIR ||
+         currentCommand.type == Command::STRING_DIR ||
+         currentCommand.type == Command::INCBIN_DIR ||
          currentCommand.type == Command::ALIGN_DIR) &&
         (previousCommand.type == Command::GLOBAL_DIR ||
          previousCommand.type == Command::EMPTY)) {
@@ -198,76 +536,64 @@ bool Assembler::isSequenceValid(const Command& previousCommand,
     return true;
 }
 
-vector<Section*> Assembler::secondPass(TokenStream& tokenStream,
-                                       int startAddress,
-                                       const SymbolTable& symbolTable) const {
-    Section* currentSection = nullptr;
-    auto locationCounter = startAddress;
-    auto previousCommand = DUMMY_COMMAND;
-    auto endDetected = false;
-    vector<Section*> sections;
+void Assembler::backpatch(const vector<Fixup>& fixups,
+                          const SymbolTable& symbolTable) const {
+    // Fixups are in source order, so the fixups of a section are adjacent
+    vector<vector<Fixup>::const_iterator> boundaries;
+    for (auto it = fixups.begin(); it != fixups.end(); ++it) {
+        if (it == fixups.begin() || it->section != (it - 1)->section) {
+            boundaries.push_back(it);
+        }
+    }
+    boundaries.push_back(fixups.end());
 
-    while (!tokenStream.end() && !endDetected) {
-        auto command = recognizer.recognizeCommand(tokenStream);
-        switch (command.type) {
-            case Command::GLOBAL_DIR:
-                recognizer.recognizeGlobalSymbols(tokenStream);
-                break;
-            case Command::END_DIR:
-                endDetected = true;
-                break;
-            case Command::SECTION:
-                currentSection = recognizer.recognizeSection(
-                    command, tokenStream, locationCounter);
-                sections.push_back(currentSection);
-                break;
-            case Command::LABEL:
-                break;
-            case Command::DEFINITION: {
-                auto definition =
-                    new Definition(recognizer.recognizeDefinition(command));
-                definition->decode(tokenStream);
-                currentSection->addRelocationData(definition->evaluate(
-                    symbolTable, locationCounter, currentSection->getName()));
-                currentSection->addIstruction(definition);
-                locationCounter += definition->getSize() / 8;
-                break;
-            }
-            case Command::ALIGN_DIR: {
-                auto alignDir = new AlignDirective();
-                locationCounter += alignDir->decode(tokenStream)
-                                       .evaluate(locationCounter)
-                                       .getSize() /
-                                   8;
-                currentSection->addIstruction(alignDir);
-                break;
-            }
-            case Command::SKIP_DIR: {
-                auto skipDir = new SkipDirective();
-                locationCounter += skipDir->decode(tokenStream).getSize() / 8;
-                currentSection->addIstruction(skipDir);
+    if (fixups.size() < PARALLEL_BACKPATCHING_SIZE ||
+        boundaries.size() < 3 || std::thread::hardware_concurrency() < 2 ||
+        ThreadPool::onWorker()) {
+        backpatchSection(fixups.begin(), fixups.end(), symbolTable);
+        return;
+    }
+    ThreadPool pool(std::min<int>(boundaries.size() - 1,
+                                  std::thread::hardware_concurrency()));
+    vector<future<void>> results;
+    for (auto i = 0u; i + 1 < boundaries.size(); i++) {
+        auto begin = boundaries[i];
+        auto end = boundaries[i + 1];
+        results.push_back(pool.submit([this, begin, end, &symbolTable] {
+            backpatchSection(begin, end, symbolTable);
+        }));
+    }
+    // Errors are rethrown in section order, as in a serial backpatch
+    for (auto&& r : results) {
+        r.get();
+    }
+}
+
+void Assembler::backpatchSection(vector<Fixup>::const_iterator begin,
+                                 vector<Fixup>::const_iterator end,
+                                 const SymbolTable& symbolTable) const {
+    // Relocations keep the order in which they appear in their sections
+    for (auto f = begin; f != end; ++f) {
+        switch (f->type) {
+            case Fixup::DEFINITION: {
+                auto definition = static_cast<Definition*>(f->statement);
+                f->section->addRelocationData(definition->evaluate(
+                    symbolTable, f->location, f->section->getId()));
                 break;
             }
-            case Command::INSTRUCTION: {
-                auto instruction = recognizer.recognizeInstruction(command);
+            case Fixup::INSTRUCTION: {
                 auto relocationData =
-                    instruction->decode(tokenStream)
-                        .evaluate(symbolTable, locationCounter,
-                                  currentSection->getName());
+                    static_cast<Instruction*>(f->statement)
+                        ->evaluate(symbolTable, f->location,
+                                   f->section->getId());
                 if (relocationData) {
-                    currentSection->addRelocationData(*relocationData);
-                    delete relocationData;
+                    f->section->addRelocationData(*relocationData);
                 }
-                currentSection->addIstruction(instruction);
-                locationCounter += instruction->getSize() / 8;
                 break;
             }
-            default:
-                throw SystemException("Unknown command " + command.name);
         }
+        f->section->patchContent(f->offset, *f->statement);
     }
-
-    return sections;
 }
 
 void Assembler::write(const vector<Section*>& sections, ostream& os) const {
@@ -275,4 +601,22 @@ void Assembler::write(const vector<Section*>& sections, ostream& os) const {
         s->writeRelData(os);
         s->writeContent(os);
     }
-}
\ No newline at end of file
+}
+void Assembler::Passes::decode(TokenStream& tokenStream, int startAddress,
+                               const StringInterner& interner) {
+    symbolTable.reset();
+    arena.reset();
+    sections.clear();
+    fixups.clear();
+    cachedSections.clear();
+    symbolTable.reset(new SymbolTable(
+        assembler.decode(tokenStream, startAddress, interner, arena, sections,
+                         fixups, nullptr, cachedSections)));
+}
+
+void Assembler::Passes::backpatch() const {
+    if (!symbolTable) {
+        throw SystemException("Nothing decoded to backpatch");
+    }
+    assembler.backpatch(fixups, *symbolTable);
+}
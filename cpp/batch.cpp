@@ -0,0 +1,126 @@
+#include "batch.h"
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "assembler.h"
+#include "exceptions_a.h"
+#include "source_buffer.h"
+#include "thread_pool.h"
+#include "utils.h"
+using std::endl;
+using std::future;
+using std::ifstream;
+using std::istream;
+using std::istringstream;
+using std::ostream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+vector<Batch::Job> Batch::readResponseFile(const string& fileName) {
+    vector<Job> jobs;
+    if (fileName == SourceBuffer::STDIN_NAME) {
+        readJobs(std::cin, fileName, jobs);
+        return jobs;
+    }
+    ifstream input(fileName.c_str());
+    if (!input.is_open()) {
+        throw SystemException("Unable to open response file " + fileName);
+    }
+    readJobs(input, fileName, jobs);
+    return jobs;
+}
+
+void Batch::readJobs(istream& input, const string& fileName,
+                     vector<Job>& jobs) {
+    string line;
+    auto lineNumber = 0;
+    while (std::getline(input, line)) {
+        lineNumber++;
+        istringstream fields(line);
+        vector<string> arguments;
+        string argument;
+        while (fields >> argument) {
+            arguments.push_back(argument);
+        }
+        if (arguments.empty() || arguments[0][0] == '#') {
+            continue;
+        }
+        auto location = " at line " + Utils::convertToString(lineNumber) +
+                        " of " + fileName;
+        if (arguments.size() < 2 || arguments.size() > 3) {
+            throw SystemException("Invalid job" + location);
+        }
+        auto startAddress = 0;
+        if (arguments.size() == 3) {
+            try {
+                startAddress = std::stoi(arguments[2], 0, 0);
+            } catch (const std::logic_error&) {
+                throw SystemException("Invalid start address " +
+                                      arguments[2] + location);
+            }
+        }
+        jobs.push_back(Job(arguments[0], arguments[1], startAddress));
+    }
+}
+
+int Batch::run(const Assembler& assembler, const vector<Job>& jobs,
+               Assembler::OutputFormat format, ostream& log,
+               int threadCount) {
+    vector<string> errors(jobs.size());
+    if (threadCount == 1) {
+        Arena arena;
+        for (auto i = 0u; i < jobs.size(); i++) {
+            errors[i] = assemble(assembler, jobs[i], format, arena);
+        }
+    } else {
+        // Every worker reuses its own arena, the errors are reported once
+        // all jobs are done so their order doesn't depend on scheduling.
+        // The arenas outlive the pool, whose workers join before they go.
+        vector<unique_ptr<Arena>> arenas;
+        ThreadPool pool(threadCount);
+        for (auto i = 0; i < pool.size(); i++) {
+            arenas.push_back(unique_ptr<Arena>(new Arena()));
+        }
+        vector<future<void>> results;
+        for (auto i = 0u; i < jobs.size(); i++) {
+            results.push_back(pool.submit([&, i] {
+                errors[i] = assemble(assembler, jobs[i], format,
+                                     *arenas[pool.workerIndex()]);
+            }));
+        }
+        for (auto&& r : results) {
+            r.get();
+        }
+    }
+
+    auto failed = 0;
+    for (auto i = 0u; i < jobs.size(); i++) {
+        if (!errors[i].empty()) {
+            log << jobs[i].inputFileName << ": " << errors[i] << endl;
+            failed++;
+        }
+    }
+    return failed;
+}
+
+string Batch::assemble(const Assembler& assembler, const Job& job,
+                       Assembler::OutputFormat format, Arena& arena) {
+    try {
+        assembler.assembleFile(job.inputFileName, job.outputFileName,
+                               job.startAddress, arena, format);
+    } catch (const AssemblerException& ae) {
+        return ae.error();
+    } catch (const std::exception& e) {
+        // Stream failures, allocation and thread errors only fail this job
+        return e.what();
+    }
+    return "";
+}
@@ -0,0 +1,17 @@
+#include "byte_writer.h"
+
+void ByteWriter::writeData(unsigned int data, int size) {
+    for (auto i = 0; i < size; i++) {
+        writeByte(data >> (i * 8));
+    }
+}
+
+void ByteWriter::writeInstruction(unsigned int data, int size) {
+    auto opcodeSize = 2;
+    for (auto i = 0; i < opcodeSize; i++) {
+        writeByte(data >> (8 * (3 - i)));
+    }
+    for (auto i = 0; i < size - opcodeSize; i++) {
+        writeByte(data >> (8 * i));
+    }
+}
@@ -0,0 +1,60 @@
+#include "cache_file.h"
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "exceptions_a.h"
+using std::ifstream;
+using std::string;
+using std::uint32_t;
+using std::vector;
+
+bool CacheFile::load(const string& fileName, string& content) {
+    ifstream input(fileName.c_str(), ifstream::binary);
+    if (!input.is_open()) {
+        return false;
+    }
+    content.assign(std::istreambuf_iterator<char>(input),
+                   std::istreambuf_iterator<char>());
+    return !input.bad();
+}
+
+bool CacheFile::save(const string& fileName, const vector<char>& content) {
+    vector<char> temporaryName(fileName.begin(), fileName.end());
+    const string suffix = ".XXXXXX";
+    temporaryName.insert(temporaryName.end(), suffix.begin(), suffix.end());
+    temporaryName.push_back('\0');
+    auto descriptor = mkstemp(temporaryName.data());
+    if (descriptor == -1) {
+        return false;
+    }
+    auto written = 0u;
+    while (written < content.size()) {
+        auto count = ::write(descriptor, content.data() + written,
+                             content.size() - written);
+        if (count <= 0) {
+            break;
+        }
+        written += count;
+    }
+    if (::close(descriptor) || written != content.size() ||
+        std::rename(temporaryName.data(), fileName.c_str())) {
+        std::remove(temporaryName.data());
+        return false;
+    }
+    return true;
+}
+
+string CacheFile::readString(const char*& current, const char* end) {
+    auto size = read<uint32_t>(current, end);
+    if (size > uint32_t(end - current)) {
+        throw SystemException("Corrupted cache file");
+    }
+    string value(current, size);
+    current += size;
+    return value;
+}
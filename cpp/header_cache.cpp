@@ -0,0 +1,355 @@
+#include "header_cache.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cache_file.h"
+#include "exceptions_a.h"
+#include "instruction.h"
+#include "section_cache.h"
+#include "string_interner.h"
+#include "string_ref.h"
+#include "token.h"
+#include "tokenizer.h"
+using std::int32_t;
+using std::int64_t;
+using std::lock_guard;
+using std::mutex;
+using std::promise;
+using std::shared_future;
+using std::shared_ptr;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+const char HeaderCache::MAGIC[4] = {'A', 'T', 'O', 'K'};
+const uint32_t HeaderCache::VERSION = 1;
+
+// Offset of the tokens whose text isn't taken from the source
+static const uint32_t FIXED_TEXT = ~0u;
+
+shared_ptr<const HeaderCache::Header> HeaderCache::get(
+    const string& fileName) {
+    auto path = realPath(fileName);
+    auto current = stamp(path);
+    shared_future<shared_ptr<const Header>> header;
+    promise<shared_ptr<const Header>> tokenized;
+    {
+        lock_guard<mutex> lock(headersMutex);
+        auto& entry = headers[path];
+        if (entry.header.valid() && entry.stamp == current) {
+            header = entry.header;
+        } else {
+            entry.stamp = current;
+            entry.header = tokenized.get_future().share();
+        }
+    }
+    // The file is being tokenized or was tokenized by another thread
+    if (header.valid()) {
+        return header.get();
+    }
+
+    // Tokenized without the lock, so a large header doesn't hold up the
+    // other files of a batch, which wait only for the files they include
+    try {
+        auto result = tokenize(path, current);
+        tokenized.set_value(result);
+        return result;
+    } catch (...) {
+        tokenized.set_exception(std::current_exception());
+        // Tried again by the next file including it
+        lock_guard<mutex> lock(headersMutex);
+        auto it = headers.find(path);
+        if (it != headers.end() && it->second.stamp == current) {
+            headers.erase(it);
+        }
+        throw;
+    }
+}
+
+shared_ptr<const HeaderCache::Header> HeaderCache::tokenize(
+    const string& path, const Stamp& current) const {
+    shared_ptr<Header> header;
+    if (!directory.empty()) {
+        header = load(path, current);
+        if (header) {
+            return header;
+        }
+    }
+    header = std::make_shared<Header>(path, current);
+    StringInterner names;
+    try {
+        header->tokens = Tokenizer(names).parse(header->text);
+    } catch (const AssemblerException& e) {
+        throw IncludedFileException(path, e);
+    }
+    for (auto i = 0; i < names.size(); i++) {
+        header->names.push_back(names.getName(i));
+    }
+    if (!directory.empty()) {
+        save(*header);
+    }
+    return header;
+}
+
+string HeaderCache::realPath(const string& fileName) {
+    auto path = ::realpath(fileName.c_str(), nullptr);
+    if (!path) {
+        throw SystemException("Unable to open included file " + fileName);
+    }
+    string result(path);
+    std::free(path);
+    return result;
+}
+
+HeaderCache::Stamp HeaderCache::stamp(const string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) == -1) {
+        throw SystemException("Unable to stat included file " + path);
+    }
+    Stamp result;
+    result.size = info.st_size;
+    result.seconds = info.st_mtim.tv_sec;
+    result.nanoseconds = info.st_mtim.tv_nsec;
+    return result;
+}
+
+const char* HeaderCache::fixedText(Token::Type type) {
+    switch (type) {
+        case Token::LINE_DELIMITER:
+            return "\n";
+        case Token::PC_RELATIVE_QUANT:
+            return "$";
+        case Token::IMMEDIATE_QUANT:
+            return "&";
+        case Token::OPEN_BRACKETS:
+            return "[";
+        case Token::CLOSED_BRACKETS:
+            return "]";
+        case Token::COMMA:
+            return ",";
+        case Token::LOCATION_VALUE_QUANT:
+            return "*";
+        default:
+            return nullptr;
+    }
+}
+
+string HeaderCache::cacheFileName(const string& path) const {
+    std::ostringstream name;
+    name << directory << '/' << std::hex
+         << SectionCache::hash(path, 0, nullptr, nullptr) << ".tokens";
+    return name.str();
+}
+
+shared_ptr<HeaderCache::Header> HeaderCache::load(const string& path,
+                                                  const Stamp& current) const {
+    string file;
+    if (!CacheFile::load(cacheFileName(path), file)) {
+        return nullptr;
+    }
+    auto begin = file.data();
+    auto end = begin + file.size();
+    try {
+        if (end - begin < 4 || std::memcmp(begin, MAGIC, sizeof(MAGIC))) {
+            return nullptr;
+        }
+        auto position = begin + sizeof(MAGIC);
+        if (CacheFile::read<uint32_t>(position, end) != VERSION ||
+            CacheFile::readString(position, end) != path) {
+            return nullptr;
+        }
+        Stamp stamp;
+        stamp.size = CacheFile::read<uint64_t>(position, end);
+        stamp.seconds = CacheFile::read<int64_t>(position, end);
+        stamp.nanoseconds = CacheFile::read<int64_t>(position, end);
+        if (!(stamp == current)) {
+            return nullptr;
+        }
+
+        auto header = std::make_shared<Header>(path, current);
+        const auto& text = header->text;
+        auto nameCount = CacheFile::read<uint32_t>(position, end);
+        for (auto i = 0u; i < nameCount; i++) {
+            header->names.push_back(CacheFile::readString(position, end));
+        }
+        auto tokenCount = CacheFile::read<uint32_t>(position, end);
+        header->tokens.reserve(tokenCount);
+        for (auto i = 0u; i < tokenCount; i++) {
+            auto type = Token::Type(CacheFile::read<unsigned char>(position, end));
+            auto offset = CacheFile::read<uint32_t>(position, end);
+            auto length = CacheFile::read<uint32_t>(position, end);
+            auto data = CacheFile::read<int32_t>(position, end);
+            if (type > Token::UNDEFINED) {
+                throw SystemException("Corrupted header cache");
+            }
+            StringRef value;
+            if (offset == FIXED_TEXT) {
+                if (!fixedText(type)) {
+                    throw SystemException("Corrupted header cache");
+                }
+                value = fixedText(type);
+            } else if (offset <= text.size() &&
+                       length <= text.size() - offset) {
+                value = StringRef(text.begin() + offset, length);
+            } else {
+                throw SystemException("Corrupted header cache");
+            }
+            if ((type == Token::IDENTIFICATOR || type == Token::LABEL) &&
+                (data < 0 || uint32_t(data) >= nameCount)) {
+                throw SystemException("Corrupted header cache");
+            }
+            header->tokens.push_back(Token(type, value, data));
+        }
+        return header;
+    } catch (const SystemException&) {
+        return nullptr;
+    }
+}
+
+void HeaderCache::save(const Header& header) const {
+    vector<char> file(MAGIC, MAGIC + sizeof(MAGIC));
+    CacheFile::append(file, VERSION);
+    CacheFile::append(file, header.path);
+    CacheFile::append(file, header.stamp.size);
+    CacheFile::append(file, header.stamp.seconds);
+    CacheFile::append(file, header.stamp.nanoseconds);
+    CacheFile::append(file, uint32_t(header.names.size()));
+    for (auto&& n : header.names) {
+        CacheFile::append(file, n);
+    }
+    CacheFile::append(file, uint32_t(header.tokens.size()));
+    const auto& text = header.text;
+    for (auto&& t : header.tokens) {
+        const auto& value = t.getText();
+        auto inText =
+            value.begin() >= text.begin() && value.end() <= text.end();
+        int32_t data = Token::NO_ID;
+        switch (t.getType()) {
+            case Token::IDENTIFICATOR:
+            case Token::LABEL:
+                data = t.getId();
+                break;
+            case Token::DEC_NUMBER:
+            case Token::HEX_NUMBER:
+            case Token::BIN_NUMBER:
+            case Token::ASCI_CHARACTER:
+                data = t.getIntValue();
+                break;
+            default:
+                break;
+        }
+        CacheFile::append(file, static_cast<unsigned char>(t.getType()));
+        CacheFile::append(file, inText ? uint32_t(value.begin() - text.begin())
+                            : FIXED_TEXT);
+        CacheFile::append(file, uint32_t(value.size()));
+        CacheFile::append(file, data);
+    }
+
+    CacheFile::save(cacheFileName(header.path), file);
+}
+
+void Includer::expand(vector<Token>& tokens, std::size_t from) {
+    auto begin = tokens.data() + from;
+    auto end = tokens.data() + tokens.size();
+    // Most inputs include nothing, so their tokens are only scanned
+    auto lineStart = true;
+    auto first = begin;
+    for (; first != end; ++first) {
+        if (lineStart && findInclude(first, end)) {
+            break;
+        }
+        lineStart = first->getType() == Token::LINE_DELIMITER;
+    }
+    if (first == end) {
+        return;
+    }
+    vector<Token> expanded;
+    expanded.reserve(tokens.size());
+    expanded.insert(expanded.end(), tokens.data(), first);
+    append(first, end, nullptr, expanded);
+    tokens.swap(expanded);
+}
+
+const Token* Includer::findInclude(const Token* lineStart, const Token* end) {
+    auto directive = lineStart;
+    if (directive->getType() == Token::LABEL) {
+        ++directive;
+    }
+    if (directive == end || directive->getType() != Token::IDENTIFICATOR) {
+        return nullptr;
+    }
+    const auto& name = directive->getText();
+    return name == ".include" || name == ".INCLUDE" ? directive : nullptr;
+}
+
+void Includer::append(const Token* begin, const Token* end,
+                      const vector<int>* ids, vector<Token>& tokens) {
+    auto lineStart = true;
+    for (auto t = begin; t != end;) {
+        if (lineStart) {
+            auto directive = findInclude(t, end);
+            if (directive) {
+                // Label in front of the directive stays on its own line
+                for (; t != directive; ++t) {
+                    tokens.push_back(ids ? Token(t->getType(), t->getText(),
+                                                 (*ids)[t->getId()])
+                                         : *t);
+                }
+                t = include(directive, end, tokens);
+                continue;
+            }
+        }
+        auto id = t->getId();
+        tokens.push_back(ids && id != Token::NO_ID
+                             ? Token(t->getType(), t->getText(), (*ids)[id])
+                             : *t);
+        lineStart = t->getType() == Token::LINE_DELIMITER;
+        ++t;
+    }
+}
+
+const Token* Includer::include(const Token* directive, const Token* end,
+                               vector<Token>& tokens) {
+    auto fileToken = directive + 1;
+    auto lineEnd = directive + 2;
+    if (fileToken >= end || fileToken->getType() != Token::STRING ||
+        lineEnd >= end || lineEnd->getType() != Token::LINE_DELIMITER) {
+        throw DecodingException(
+            "Format of the .include directive must be .include \"file\"");
+    }
+    tokens.push_back(*lineEnd);
+
+    auto header =
+        cache.get(StringDirective::unescape(fileToken->getText()));
+    if (std::find(including.begin(), including.end(), header->path) !=
+        including.end()) {
+        throw DecodingException("File " + header->path + " includes itself");
+    }
+    auto it = ids.find(header.get());
+    if (it == ids.end()) {
+        vector<int> headerIds;
+        headerIds.reserve(header->names.size());
+        for (auto&& n : header->names) {
+            headerIds.push_back(interner.intern(n));
+        }
+        it = ids.emplace(header.get(), std::move(headerIds)).first;
+        used.push_back(header);
+    }
+
+    including.push_back(header->path);
+    append(header->tokens.data(),
+           header->tokens.data() + header->tokens.size(), &it->second,
+           tokens);
+    including.pop_back();
+    return lineEnd + 1;
+}
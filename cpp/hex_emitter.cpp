@@ -0,0 +1,69 @@
+#include "hex_emitter.h"
+#include <array>
+#include <cstring>
+#include <ostream>
+using std::array;
+using std::ostream;
+
+const std::size_t HexEmitter::BUFFER_SIZE = 0x10000;
+
+array<array<char, 2>, 256> HexEmitter::constructHexDigits() {
+    const char digits[] = "0123456789abcdef";
+    array<array<char, 2>, 256> hex;
+    for (auto i = 0; i < 256; i++) {
+        hex[i][0] = digits[i >> 4];
+        hex[i][1] = digits[i & 0xF];
+    }
+    return hex;
+}
+
+const array<array<char, 2>, 256> HexEmitter::hexDigits = constructHexDigits();
+
+HexEmitter::HexEmitter(ostream& os)
+    : os(os), buffer(BUFFER_SIZE), used(0), column(0) {}
+
+void HexEmitter::writeBytes(const unsigned char* begin,
+                            const unsigned char* end) {
+    for (auto current = begin; current != end; current++) {
+        writeByte(*current);
+    }
+}
+
+void HexEmitter::writeFill(unsigned char d, std::size_t count) {
+    for (; count && column; count--) {
+        writeByte(d);
+    }
+    if (count >= BYTES_PER_LINE) {
+        array<char, 3 * BYTES_PER_LINE> line;
+        for (auto i = 0; i < BYTES_PER_LINE; i++) {
+            line[3 * i] = hexDigits[d][0];
+            line[3 * i + 1] = hexDigits[d][1];
+            line[3 * i + 2] = i + 1 < BYTES_PER_LINE ? ' ' : '\n';
+        }
+        for (; count >= BYTES_PER_LINE; count -= BYTES_PER_LINE) {
+            if (BUFFER_SIZE - used < line.size()) {
+                flush();
+            }
+            std::memcpy(buffer.data() + used, line.data(), line.size());
+            used += line.size();
+        }
+    }
+    for (; count; count--) {
+        writeByte(d);
+    }
+}
+
+void HexEmitter::endLine() {
+    if (column) {
+        if (used == BUFFER_SIZE) {
+            flush();
+        }
+        buffer[used++] = '\n';
+        column = 0;
+    }
+}
+
+void HexEmitter::flush() {
+    os.write(buffer.data(), used);
+    used = 0;
+}
@@ -1,8 +1,11 @@
 #include "instruction.h"
+#include <cstring>
+#include <string>
 #include <vector>
+#include "byte_writer.h"
 #include "token.h"
 #include "tokenizer.h"
-using std::ostream;
+using std::string;
 using std::vector;
 
 WritableDirective& Definition::decode(TokenStream& tokenStream) {
@@ -13,8 +16,9 @@ WritableDirective& Definition::decode(TokenStream& tokenStream) {
     auto secondToken = tokenStream.next();
     while (true) {
         datas.push_back(Operand(
-            firstToken, {REG_DIRECT, REG_INDIRECT_W_DISPL, MEMORY_CONSTANT,
-                         IMMEDIATE_SYMBOL, PC_RELATIVE, PSW}));
+            firstToken,
+            Operand::modeSet(REG_DIRECT, REG_INDIRECT_W_DISPL, MEMORY_CONSTANT,
+                             IMMEDIATE_SYMBOL, PC_RELATIVE, PSW)));
         if (secondToken.getType() == Token::LINE_DELIMITER) {
             return *this;
         }
@@ -28,7 +32,7 @@ WritableDirective& Definition::decode(TokenStream& tokenStream) {
 
 vector<RelocationData> Definition::evaluate(const SymbolTable& symbolTable,
                                             int address,
-                                            const std::string& section) {
+                                            int section) {
     vector<RelocationData> relData;
     auto cnt = 0;
     auto size = getSize();
@@ -36,25 +40,22 @@ vector<RelocationData> Definition::evaluate(const SymbolTable& symbolTable,
         auto displ = cnt * multiplier;
         auto r = data.evaluate(symbolTable, address + displ, address + size,
                                section);
-        if (r != nullptr) {
+        if (r) {
             relData.push_back(*r);
-            delete r;
         }
         cnt++;
     }
     return relData;
 }
 
-int Definition::write(ostream& os, int currentColumn) const {
+void Definition::write(ByteWriter& writer) const {
     if (datas.size() == 0) {
-        return Utils::writeData(os, 0, multiplier, currentColumn);
+        writer.writeData(0, multiplier);
     } else {
         for (auto&& data : datas) {
-            currentColumn = Utils::writeData(os, data.getFullConstantData(),
-                                             multiplier, currentColumn);
+            writer.writeData(data.getFullConstantData(), multiplier);
         }
     }
-    return currentColumn;
 }
 
 WritableDirective& SkipDirective::decode(TokenStream& tokenStream) {
@@ -90,12 +91,8 @@ WritableDirective& SkipDirective::decode(TokenStream& tokenStream) {
         "Format of the .skip directive must be .skip size, [fill]");
 }
 
-int SkipDirective::write(ostream& os, int currentColumn) const {
-    auto newColumn = currentColumn;
-    for (int i = 0; i < size; i++) {
-        newColumn = Utils::writeData(os, fill, 1, newColumn);
-    }
-    return newColumn;
+void SkipDirective::write(ByteWriter& writer) const {
+    writer.writeFill(fill, size);
 }
 
 AlignDirective& AlignDirective::decode(TokenStream& tokenStream) {
@@ -105,8 +102,11 @@ AlignDirective& AlignDirective::decode(TokenStream& tokenStream) {
         type != Token::HEX_NUMBER) {
         throw DecodingException("Padd must be an int value");
     }
-    auto secondToken = tokenStream.next();
     padd = firstToken.getIntValue();
+    if (padd <= 0) {
+        throw DecodingException("Padd must be a positive value");
+    }
+    auto secondToken = tokenStream.next();
     if (secondToken.getType() == Token::LINE_DELIMITER) {
         return *this;
     }
@@ -152,112 +152,283 @@ AlignDirective& AlignDirective::decode(TokenStream& tokenStream) {
 }
 
 AlignDirective& AlignDirective::evaluate(int currentLocationCounter) {
-    auto newLocationCounter = currentLocationCounter;
-    while (newLocationCounter % padd) {
-        newLocationCounter++;
-    }
-    auto calculatedPad = newLocationCounter - currentLocationCounter;
+    // Distance to the next multiple of padd
+    auto calculatedPad = (padd - currentLocationCounter % padd) % padd;
     size = calculatedPad > maxPadd ? 0 : calculatedPad;
     return *this;
 }
 
-int AlignDirective::write(ostream& os, int currentColumn) const {
-    auto newColumn = currentColumn;
-    for (int i = 0; i < size; i++) {
-        newColumn = Utils::writeData(os, fill, 1, newColumn);
+void AlignDirective::write(ByteWriter& writer) const {
+    writer.writeFill(fill, size);
+}
+
+StringDirective& StringDirective::decode(TokenStream& tokenStream) {
+    while (true) {
+        auto stringToken = tokenStream.next();
+        if (stringToken.getType() != Token::STRING) {
+            throw DecodingException(
+                "String directive can only contain string literals");
+        }
+        const auto& text = stringToken.getText();
+        strings.push_back(text);
+        // Every escape sequence is a single byte
+        for (auto current = text.begin(); current != text.end(); size++) {
+            if (*current++ == '\\') {
+                unescape(current, text.end());
+            }
+        }
+        if (terminated) {
+            size++;
+        }
+        auto separator = tokenStream.next();
+        if (separator.getType() == Token::LINE_DELIMITER) {
+            return *this;
+        }
+        if (separator.getType() != Token::COMMA) {
+            throw DecodingException(
+                "Format of the string directive must be .ascii "
+                "\"string\"[, \"string\"]");
+        }
+    }
+}
+
+void StringDirective::write(ByteWriter& writer) const {
+    for (auto&& s : strings) {
+        auto current = s.begin();
+        while (current != s.end()) {
+            auto escape = static_cast<const char*>(
+                std::memchr(current, '\\', s.end() - current));
+            auto runEnd = escape ? escape : s.end();
+            writer.writeBytes(current, runEnd);
+            current = runEnd;
+            if (escape) {
+                current++;
+                writer.writeByte(unescape(current, s.end()));
+            }
+        }
+        if (terminated) {
+            writer.writeByte(0);
+        }
+    }
+}
+
+unsigned char StringDirective::unescape(const char*& current,
+                                        const char* end) {
+    auto isOctal = [](char c) { return c >= '0' && c <= '7'; };
+    auto isHex = [](char c) {
+        return (c >= '0' && c <= '9') ||
+               ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+    };
+    auto c = *current++;
+    switch (c) {
+        case 'n':
+            return '\n';
+        case 't':
+            return '\t';
+        case 'r':
+            return '\r';
+        case '\\':
+        case '"':
+        case '\'':
+            return c;
+        case 'x': {
+            // One or two hex digits
+            unsigned value = 0;
+            auto digits = 0;
+            for (; digits < 2 && current != end && isHex(*current);
+                 digits++, current++) {
+                auto d = *current | 0x20;
+                value = value * 16 + (d >= 'a' ? d - 'a' + 10 : d - '0');
+            }
+            if (digits == 0) {
+                throw DecodingException(
+                    "Invalid escape sequence \\x in string");
+            }
+            return value;
+        }
+    }
+    if (isOctal(c)) {
+        // Up to three octal digits, \0 among them
+        unsigned value = c - '0';
+        for (auto digits = 1;
+             digits < 3 && current != end && isOctal(*current);
+             digits++, current++) {
+            value = value * 8 + (*current - '0');
+        }
+        return value;
+    }
+    throw DecodingException("Invalid escape sequence \\" + string(1, c) +
+                            " in string");
+}
+
+string StringDirective::unescape(const StringRef& text) {
+    string characters;
+    for (auto current = text.begin(); current != text.end();) {
+        auto c = *current++;
+        if (c == '\\') {
+            c = unescape(current, text.end());
+        }
+        characters += c;
+    }
+    return characters;
+}
+
+IncbinDirective& IncbinDirective::decode(TokenStream& tokenStream) {
+    auto fileToken = tokenStream.next();
+    if (fileToken.getType() != Token::STRING) {
+        throw DecodingException(
+            "File of the .incbin directive must be a string literal");
+    }
+    fileName = StringDirective::unescape(fileToken.getText());
+    if (fileName.empty()) {
+        throw DecodingException("File name of the .incbin directive is empty");
+    }
+    for (auto parameter = 0; parameter < 2; parameter++) {
+        auto separator = tokenStream.next();
+        if (separator.getType() == Token::LINE_DELIMITER) {
+            return *this;
+        }
+        if (separator.getType() != Token::COMMA) {
+            throw DecodingException(
+                "Format of the .incbin directive must be .incbin "
+                "\"file\"[, offset[, length]]");
+        }
+        auto number = tokenStream.next();
+        auto type = number.getType();
+        if (type != Token::HEX_NUMBER && type != Token::BIN_NUMBER &&
+            type != Token::DEC_NUMBER) {
+            throw DecodingException(
+                "Offset and length of the .incbin directive must be numbers");
+        }
+        if (number.getIntValue() < 0) {
+            throw DecodingException(
+                "Offset and length of the .incbin directive can't be "
+                "negative");
+        }
+        if (parameter == 0) {
+            offset = number.getIntValue();
+        } else {
+            length = number.getIntValue();
+            lengthGiven = true;
+        }
+    }
+    if (tokenStream.next().getType() != Token::LINE_DELIMITER) {
+        throw DecodingException(
+            "Format of the .incbin directive must be .incbin "
+            "\"file\"[, offset[, length]]");
+    }
+    return *this;
+}
+
+IncbinDirective& IncbinDirective::evaluate(std::size_t fileSize) {
+    if (offset > fileSize || (lengthGiven && length > fileSize - offset)) {
+        throw DecodingException("Range of the .incbin directive is outside "
+                                "of the file " + fileName);
+    }
+    if (!lengthGiven) {
+        length = fileSize - offset;
     }
-    return newColumn;
+    return *this;
 }
 
 // NOTE: insert immediate address checking if necessary
 Instruction& SingleAddressInstruction::decode(TokenStream& tokenStream) {
-    vector<Token> operandTokens;
+    auto operandStart = tokenStream.position();
     while (!tokenStream.end()) {
-        auto t = tokenStream.next();
+        auto& t = tokenStream.next();
         if (t.getType() == Token::LINE_DELIMITER) {
-            operand = new Operand(operandTokens,
-                                  {IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL});
+            operand =
+                Operand(TokenRange(operandStart, &t),
+                        Operand::modeSet(IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL));
             return *this;
         }
-        operandTokens.push_back(t);
     }
-    throw DecodingException("Invalid end of instruction " + name);
+    throw DecodingException("Invalid end of instruction " + name());
 }
 
-int SingleAddressInstruction::write(ostream& os, int currentColumn) const {
-    unsigned int data = opcode << 26 |
-                        (dstExists ? operand->getRegData() << 21
-                                   : operand->getRegData() << 16) |
-                        operand->getConstantData();
-    return Utils::writeInstruction(os, data, getSize() / 8, currentColumn);
+void SingleAddressInstruction::write(ByteWriter& writer) const {
+    unsigned int data = specification->opcode << 26 |
+                        (specification->dst ? operand.getRegData() << 21
+                                   : operand.getRegData() << 16) |
+                        operand.getConstantData();
+    writer.writeInstruction(data, getSize() / 8);
 }
 
 Instruction& DoubleAddressInstruction::decode(TokenStream& tokenStream) {
-    vector<Token> dstTokens;
-    vector<Token> srcTokens;
-    while (!tokenStream.end()) {
-        auto t = tokenStream.next();
+    auto dstStart = tokenStream.position();
+    auto dstEnd = dstStart;
+    // The operand ends on its line, a streamed block ends only with a line
+    // so the range can't span two blocks
+    while (true) {
+        if (tokenStream.end()) {
+            throw DecodingException("Invalid dst operand for instruction " +
+                                    name());
+        }
+        auto& t = tokenStream.next();
+        if (t.getType() == Token::LINE_DELIMITER) {
+            throw DecodingException("Invalid dst operand for instruction " +
+                                    name());
+        }
         if (t.getType() == Token::COMMA) {
+            dstEnd = &t;
             dst =
-                new Operand(dstTokens, {IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL});
+                Operand(TokenRange(dstStart, dstEnd),
+                        Operand::modeSet(IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL));
             break;
         }
-        dstTokens.push_back(t);
-    }
-    if (tokenStream.end()) {
-        throw DecodingException("Invalid dst operand for instruction " + name);
     }
+    auto srcStart = tokenStream.position();
     while (!tokenStream.end()) {
-        auto t = tokenStream.next();
+        auto& t = tokenStream.next();
         if (t.getType() == Token::LINE_DELIMITER) {
-            src = new Operand(srcTokens);
-            if (src->getSize() + dst->getSize() > 26) {
+            auto srcTokens = TokenRange(srcStart, &t);
+            src = Operand(srcTokens);
+            if (src.getSize() + dst.getSize() > 26) {
                 throw DecodingException(
                     "Only one operand can have additional data for operands " +
                     Token::joinTokens(srcTokens) + " " +
-                    Token::joinTokens(dstTokens));
+                    Token::joinTokens(TokenRange(dstStart, dstEnd)));
             }
             return *this;
         }
-        srcTokens.push_back(t);
     }
-    throw DecodingException("Invalid src operand for instruction " + name);
+    throw DecodingException("Invalid src operand for instruction " + name());
 }
 
-int DoubleAddressInstruction::write(ostream& os, int currentColumn) const {
-    auto dstSize = dst->getSize();
-    auto srcSize = src->getSize();
+void DoubleAddressInstruction::write(ByteWriter& writer) const {
+    auto dstSize = dst.getSize();
+    auto srcSize = src.getSize();
     unsigned int data =
-        opcode << 26 | dst->getRegData() << 21 | src->getRegData() << 16 |
-        (srcSize > dstSize ? src->getConstantData() : dst->getConstantData());
+        specification->opcode << 26 | dst.getRegData() << 21 |
+        src.getRegData() << 16 |
+        (srcSize > dstSize ? src.getConstantData() : dst.getConstantData());
     // os << "Name " << name << dstSize << " " << srcSize << std::endl;
-    return Utils::writeInstruction(os, data, (dstSize + srcSize + 6) / 8,
-                                   currentColumn);
+    writer.writeInstruction(data, (dstSize + srcSize + 6) / 8);
 }
 
 Instruction& JmpInstruction::decode(TokenStream& tokenStream) {
-    vector<Token> operandTokens;
+    auto operandStart = tokenStream.position();
+    auto operandEnd = operandStart;
     while (!tokenStream.end()) {
-        auto t = tokenStream.next();
+        auto& t = tokenStream.next();
         if (t.getType() == Token::LINE_DELIMITER) {
+            operandEnd = &t;
             break;
         }
-        operandTokens.push_back(t);
     }
     if (tokenStream.end()) {
         throw DecodingException("Invalid end of file");
     }
-    operand =
-        new Operand(operandTokens, {IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL});
-    opcode = operand->getAddressMode() == PC_RELATIVE ? 0x00 : 0x0D;
+    operand = Operand(TokenRange(operandStart, operandEnd),
+                      Operand::modeSet(IMMEDIATE_CONSTANT, IMMEDIATE_SYMBOL));
+    opcode = operand.getAddressMode() == PC_RELATIVE ? 0x00 : 0x0D;
     return *this;
 }
 
-int JmpInstruction::write(ostream& os, int currentColumn) const {
-    auto operandSize = operand->getSize();
-    unsigned int data = prefix << 30 | opcode << 26 | 15 << 21 |
-                        operand->getRegData() << 16 |
-                        operand->getConstantData();
-    return Utils::writeInstruction(os, data, (operandSize + 11) / 8,
-                                   currentColumn);
+void JmpInstruction::write(ByteWriter& writer) const {
+    auto operandSize = operand.getSize();
+    unsigned int data = specification->opcode << 30 | opcode << 26 | 15 << 21 |
+                        operand.getRegData() << 16 |
+                        operand.getConstantData();
+    writer.writeInstruction(data, (operandSize + 11) / 8);
 }
\ No newline at end of file
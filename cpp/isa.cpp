@@ -0,0 +1,9 @@
+#include "isa.h"
+
+constexpr Isa::Mnemonic Isa::MNEMONICS[];
+constexpr Isa::Condition Isa::CONDITIONS[];
+
+static_assert(Instructions::SPECIFICATIONS[1].opcode == 0x00 &&
+                  Instructions::SPECIFICATIONS[2].opcode == 0x10 &&
+                  Instructions::SPECIFICATIONS[5].opcode == 0x31,
+              "Condition codes must be the upper part of the opcode");
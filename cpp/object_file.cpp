@@ -0,0 +1,230 @@
+#include "object_file.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "data.h"
+#include "exceptions_a.h"
+#include "section.h"
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "symbol_table.h"
+#include "utils.h"
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::uint32_t;
+using std::vector;
+
+const char ObjectFile::MAGIC[4] = {'A', 'O', 'B', 'J'};
+const uint32_t ObjectFile::VERSION = 1;
+
+void ObjectFile::write(ostream& os, const SymbolTable& symbolTable,
+                       const vector<Section*>& sections) {
+    const auto& tableSections = symbolTable.getSections();
+    const auto& symbols = symbolTable.getSymbols();
+
+    vector<char> strings;
+    auto addString = [&strings](const string& str) {
+        uint32_t offset = strings.size();
+        strings.insert(strings.end(), str.begin(), str.end());
+        strings.push_back('\0');
+        return offset;
+    };
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sectionCount = sections.size();
+    header.sectionOffset = sizeof(Header);
+    header.symbolCount = symbols.size();
+    header.symbolOffset =
+        header.sectionOffset + header.sectionCount * sizeof(SectionHeader);
+    header.relocationCount = 0;
+    header.relocationOffset =
+        header.symbolOffset + header.symbolCount * sizeof(SymbolRecord);
+
+    vector<SectionHeader> sectionHeaders;
+    for (auto i = 0u; i < sections.size(); i++) {
+        const auto& s = *sections[i];
+        const auto& ts = tableSections[i];
+        SectionHeader sectionHeader;
+        sectionHeader.name = addString(s.getName());
+        sectionHeader.type = s.getType();
+        sectionHeader.number = ts.number;
+        sectionHeader.address = ts.address;
+        sectionHeader.size = ts.size;
+        sectionHeader.firstRelocation = header.relocationCount;
+        sectionHeader.relocationCount = s.getRelocations().size();
+        header.relocationCount += sectionHeader.relocationCount;
+        sectionHeader.contentSize = s.getContentSize();
+        sectionHeaders.push_back(sectionHeader);
+    }
+
+    vector<SymbolRecord> symbolRecords;
+    for (auto&& symbol : symbols) {
+        SymbolRecord record;
+        record.name = addString(symbol.name);
+        record.section = symbol.section;
+        record.address = symbol.address;
+        record.number = symbol.number;
+        record.scope = symbol.scope;
+        symbolRecords.push_back(record);
+    }
+
+    header.stringTableOffset = header.relocationOffset +
+                               header.relocationCount * sizeof(RelocationRecord);
+    header.stringTableSize = strings.size();
+    auto contentOffset = align(header.stringTableOffset + strings.size());
+    for (auto&& sh : sectionHeaders) {
+        sh.contentOffset = contentOffset;
+        contentOffset = align(contentOffset + sh.contentSize);
+    }
+
+    // Records before the contents, the contents are written straight from
+    // the sections so included files aren't copied
+    vector<char> file;
+    file.reserve(header.stringTableOffset + strings.size());
+    append(file, header);
+    for (auto&& sh : sectionHeaders) {
+        append(file, sh);
+    }
+    for (auto&& sr : symbolRecords) {
+        append(file, sr);
+    }
+    for (auto&& s : sections) {
+        for (auto&& r : s->getRelocations()) {
+            RelocationRecord record;
+            record.offset = r.getOffset();
+            record.info = r.getValue() << 1 | r.getType();
+            append(file, record);
+        }
+    }
+    file.insert(file.end(), strings.begin(), strings.end());
+    os.write(file.data(), file.size());
+
+    std::size_t position = file.size();
+    for (auto i = 0u; i < sectionHeaders.size(); i++) {
+        writeFill(os, 0, sectionHeaders[i].contentOffset - position);
+        sections[i]->forEachRun(
+            [&os](const unsigned char* begin, const unsigned char* end) {
+                os.write(reinterpret_cast<const char*>(begin), end - begin);
+            },
+            [&os](unsigned char byte, std::size_t length) {
+                writeFill(os, byte, length);
+            });
+        position =
+            sectionHeaders[i].contentOffset + sectionHeaders[i].contentSize;
+    }
+    writeFill(os, 0, contentOffset - position);
+}
+
+void ObjectFile::writeFill(ostream& os, unsigned char byte,
+                           std::size_t length) {
+    char block[FILL_BLOCK_SIZE];
+    std::memset(block, byte, std::min(length, sizeof(block)));
+    for (; length > sizeof(block); length -= sizeof(block)) {
+        os.write(block, sizeof(block));
+    }
+    os.write(block, length);
+}
+
+void ObjectFile::dumpFile(const string& inputFileName,
+                          const string& outputFileName) {
+    SourceBuffer input(inputFileName);
+    ofstream output;
+    output.open(outputFileName.c_str());
+    dump(input.begin(), input.end(), output);
+    output.close();
+}
+
+template <typename T>
+void ObjectFile::append(vector<char>& file, const T& record) {
+    auto bytes = reinterpret_cast<const char*>(&record);
+    file.insert(file.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+const T* ObjectFile::records(const char* begin, const char* end,
+                             uint32_t offset, uint32_t count) {
+    if (offset % 4 || offset > uint32_t(end - begin) ||
+        count > (uint32_t(end - begin) - offset) / sizeof(T)) {
+        throw SystemException("Corrupted object file");
+    }
+    return reinterpret_cast<const T*>(begin + offset);
+}
+
+string ObjectFile::name(const char* begin, const Header& header,
+                        uint32_t offset) {
+    auto strings = begin + header.stringTableOffset;
+    if (offset >= header.stringTableSize ||
+        !std::memchr(strings + offset, '\0', header.stringTableSize - offset)) {
+        throw SystemException("Corrupted object file");
+    }
+    return string(strings + offset);
+}
+
+void ObjectFile::dump(const char* begin, const char* end, ostream& os) {
+    auto header = records<Header>(begin, end, 0, 1);
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) ||
+        header->version != VERSION) {
+        throw SystemException("Not an object file of version " +
+                              Utils::convertToString(VERSION));
+    }
+    auto sectionHeaders = records<SectionHeader>(
+        begin, end, header->sectionOffset, header->sectionCount);
+    auto symbolRecords = records<SymbolRecord>(
+        begin, end, header->symbolOffset, header->symbolCount);
+    auto relocationRecords = records<RelocationRecord>(
+        begin, end, header->relocationOffset, header->relocationCount);
+    records<char>(begin, end, header->stringTableOffset,
+                  header->stringTableSize);
+
+    // Symbol table is rebuilt, so it's printed the way the assembler does
+    StringInterner interner;
+    SymbolTable symbolTable(interner);
+    for (auto sh = sectionHeaders; sh != sectionHeaders + header->sectionCount;
+         sh++) {
+        auto id = interner.intern(name(begin, *header, sh->name));
+        symbolTable.putSection(id, sh->address);
+        symbolTable.updateSectionSize(id, sh->size);
+        symbolTable.updateRelocationSectionSize(id, sh->relocationCount * 4);
+    }
+    for (auto sr = symbolRecords; sr != symbolRecords + header->symbolCount;
+         sr++) {
+        symbolTable.putSymbol(interner.intern(name(begin, *header, sr->name)),
+                              sr->address, SymbolTable::Scope(sr->scope),
+                              sr->section);
+    }
+    symbolTable.setSymbolNumbers();
+    os << symbolTable;
+
+    for (auto sh = sectionHeaders; sh != sectionHeaders + header->sectionCount;
+         sh++) {
+        if (sh->type == Section::BSS) {
+            continue;
+        }
+        if (sh->firstRelocation > header->relocationCount ||
+            sh->relocationCount > header->relocationCount - sh->firstRelocation) {
+            throw SystemException("Corrupted object file");
+        }
+        vector<RelocationData> relocations;
+        for (auto r = relocationRecords + sh->firstRelocation;
+             r != relocationRecords + sh->firstRelocation + sh->relocationCount;
+             r++) {
+            relocations.push_back(RelocationData(
+                r->offset, RelocationData::Type(r->info & 1), r->info >> 1));
+        }
+        auto content = records<unsigned char>(begin, end, sh->contentOffset,
+                                              sh->contentSize);
+        auto sectionName = name(begin, *header, sh->name);
+        Section::writeRelData(os, sectionName, relocations.data(),
+                              relocations.data() + relocations.size());
+        Section::writeContent(os, sectionName, content,
+                              content + sh->contentSize);
+    }
+}
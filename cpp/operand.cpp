@@ -1,72 +1,42 @@
 #include "operand.h"
 #include <string>
-#include <vector>
+#include <type_traits>
 #include "data.h"
+#include "string_ref.h"
 #include "token.h"
 #include "utils.h"
 using std::string;
-using std::vector;
 
-vector<Operand::Registry> Operand::constructRegistries() {
-    vector<Registry> r;
-    r.push_back(Registry("r0", 0));
-    r.push_back(Registry("r1", 1));
-    r.push_back(Registry("r2", 2));
-    r.push_back(Registry("r3", 3));
-    r.push_back(Registry("r4", 4));
-    r.push_back(Registry("r5", 5));
-    r.push_back(Registry("r6", 6));
-    r.push_back(Registry("r7", 7));
-    return r;
-}
+static_assert(std::is_trivially_copyable<Operand>::value,
+              "Operands are copied around as plain values");
+static_assert(sizeof(Operand) <= 16, "Operands are stored inline");
 
-const std::vector<Operand::Registry> Operand::registries =
-    constructRegistries();
+const Operand::Registry Operand::registries[] = {
+    {"r0", 0}, {"r1", 1}, {"r2", 2}, {"r3", 3},
+    {"r4", 4}, {"r5", 5}, {"r6", 6}, {"r7", 7}};
 
-int Operand::getRegistry(const string& name) {
-    auto pos = 0;
+int Operand::getRegistry(const StringRef& name) {
     for (auto&& r : registries) {
-        if (r.name == name) {
-            return pos;
+        if (name == r.name) {
+            return &r - registries;
         }
-        pos++;
     }
     return -1;
 }
 
-Operand::Operand(const vector<Token>& tokens,
-                 const vector<AddressMode>& invalidAddressModes)
-    : constantDataRaw(UNDEFINED_TOKEN) {
+Operand::Operand(const TokenRange& tokens, unsigned int invalidAddressModes)
+    : registryData(0), constantData(0), symbolId(Token::NO_ID) {
     determineOperand(tokens);
-    if (isIllegalAddressMode(invalidAddressModes)) {
+    if (invalidAddressModes & modeSet(addressMode)) {
         throw DecodingException("Invalid address mode for " +
                                 Token::joinTokens(tokens));
     }
 }
 
-Operand::Operand(const Token& token,
-                 const vector<AddressMode>& invalidAddressModes)
-    : constantDataRaw(UNDEFINED_TOKEN) {
-    std::vector<Token> tokens;
-    tokens.push_back(token);
-    determineOperand(tokens);
-    if (isIllegalAddressMode(invalidAddressModes)) {
-        throw DecodingException("Invalid address mode for " +
-                                Token::joinTokens(tokens));
-    }
-}
+Operand::Operand(const Token& token, unsigned int invalidAddressModes)
+    : Operand(TokenRange(&token, &token + 1), invalidAddressModes) {}
 
-bool Operand::isIllegalAddressMode(
-    const vector<AddressMode>& invalidAddressModes) const {
-    for (auto&& iam : invalidAddressModes) {
-        if (addressMode == iam) {
-            return true;
-        }
-    }
-    return false;
-}
-
-void Operand::determineOperand(const vector<Token>& tokens) {
+void Operand::determineOperand(const TokenRange& tokens) {
     switch (tokens[0].getType()) {
         case Token::HEX_NUMBER:
         case Token::BIN_NUMBER:
@@ -85,7 +55,7 @@ void Operand::determineOperand(const vector<Token>& tokens) {
                                         Token::joinTokens(tokens));
             }
             addressMode = IMMEDIATE_SYMBOL;
-            constantDataRaw = tokens[1];
+            symbolId = tokens[1].getId();
             return;
         case Token::LOCATION_VALUE_QUANT:
             if (tokens.size() != 2 ||
@@ -105,10 +75,10 @@ void Operand::determineOperand(const vector<Token>& tokens) {
                                         Token::joinTokens(tokens));
             }
             addressMode = PC_RELATIVE;
-            constantDataRaw = tokens[1];
+            symbolId = tokens[1].getId();
             return;
         case Token::IDENTIFICATOR: {
-            auto index = getRegistry(tokens[0].getValue());
+            auto index = getRegistry(tokens[0].getText());
             if (index != -1) {
                 if (tokens.size() == 1) {
                     addressMode = REG_DIRECT;
@@ -123,20 +93,31 @@ void Operand::determineOperand(const vector<Token>& tokens) {
                 }
                 addressMode = REG_INDIRECT_W_DISPL;
                 registryData = registries[index].code;
-                constantDataRaw = tokens[2];
-                return;
+                switch (tokens[2].getType()) {
+                    case Token::IDENTIFICATOR:
+                        symbolId = tokens[2].getId();
+                        return;
+                    case Token::HEX_NUMBER:
+                    case Token::BIN_NUMBER:
+                    case Token::DEC_NUMBER:
+                        constantData = tokens[2].getIntValue();
+                        return;
+                    default:
+                        throw DecodingException("Invalid operand " +
+                                                Token::joinTokens(tokens));
+                }
             }
             if (tokens.size() != 1) {
                 throw DecodingException("Invalid operand " +
                                         Token::joinTokens(tokens));
             }
-            if (tokens[0].getValue() == "PSW" ||
-                tokens[0].getValue() == "psw") {
+            if (tokens[0].getText() == "PSW" ||
+                tokens[0].getText() == "psw") {
                 addressMode = PSW;
                 return;
             }
             addressMode = MEMORY_SYMBOL;
-            constantDataRaw = tokens[0];
+            symbolId = tokens[0].getId();
             return;
         }
         case Token::ASCI_CHARACTER:
@@ -145,7 +126,7 @@ void Operand::determineOperand(const vector<Token>& tokens) {
                                         Token::joinTokens(tokens));
             }
             addressMode = IMMEDIATE_CONSTANT;
-            constantData = tokens[0].getValue()[0];
+            constantData = tokens[0].getIntValue();
             return;
         default:
             throw DecodingException("Invalid operand " +
@@ -153,43 +134,42 @@ void Operand::determineOperand(const vector<Token>& tokens) {
     }
 }
 
-RelocationData* Operand::evaluate(const SymbolTable& symbolTable,
-                                  int myLocation, int nextInstructionLocation,
-                                  const std::string& mySection) {
+Optional<RelocationData> Operand::evaluate(const SymbolTable& symbolTable,
+                                           int myLocation,
+                                           int nextInstructionLocation,
+                                           int mySection) {
     switch (addressMode) {
         case IMMEDIATE_CONSTANT:
         case MEMORY_CONSTANT:
         case PSW:
         case REG_DIRECT:
-            return nullptr;
+            return Optional<RelocationData>();
         case REG_INDIRECT_W_DISPL:
-            if (constantDataRaw.getType() != Token::IDENTIFICATOR) {
-                constantData = constantDataRaw.getIntValue();
-                return nullptr;
+            if (!referencesSymbol()) {
+                return Optional<RelocationData>();
             }
         case IMMEDIATE_SYMBOL:
         case MEMORY_SYMBOL: {
-            auto symbol = symbolTable.getSymbol(constantDataRaw.getValue());
-            auto section = symbolTable.getSection(mySection);
+            const auto& symbol = symbolTable.getSymbol(symbolId);
             constantData = symbol.address;
-            return new RelocationData(myLocation, RelocationData::APSOLUTE,
-                                      symbol.scope == SymbolTable::LOCAL
-                                          ? symbol.section
-                                          : symbol.number);
+            return RelocationData(
+                myLocation, RelocationData::APSOLUTE,
+                symbol.scope == SymbolTable::LOCAL ? symbol.section
+                                                   : symbol.number);
         }
         case PC_RELATIVE: {
-            auto symbol = symbolTable.getSymbol(constantDataRaw.getValue());
-            auto section = symbolTable.getSection(mySection);
+            const auto& symbol = symbolTable.getSymbol(symbolId);
+            const auto& section = symbolTable.getSection(mySection);
             if (section.number == symbol.section) {
                 constantData = symbol.address - nextInstructionLocation;
-                return nullptr;
+                return Optional<RelocationData>();
             }
             constantData =
                 symbol.address - (nextInstructionLocation - myLocation);
-            return new RelocationData(myLocation, RelocationData::RELATIVE,
-                                      symbol.scope == SymbolTable::LOCAL
-                                          ? symbol.section
-                                          : symbol.number);
+            return RelocationData(
+                myLocation, RelocationData::RELATIVE,
+                symbol.scope == SymbolTable::LOCAL ? symbol.section
+                                                   : symbol.number);
         }
     }
 }
@@ -2,347 +2,202 @@
 #include "data.h"
 #include "exceptions_a.h"
 #include "instruction.h"
+#include "isa.h"
 #include "section.h"
+#include "string_ref.h"
 #include "tokenizer.h"
-#include "utils.h"
 
+#include <array>
 #include <string>
 #include <vector>
+using std::array;
 using std::string;
 using std::vector;
 
-Recognizer::Recognizer() {
-    sectionSpecifications.push_back(
-        SectionSpecification(".data", Section::DATA));
-    sectionSpecifications.push_back(
-        SectionSpecification(".text", Section::TEXT));
-    sectionSpecifications.push_back(SectionSpecification(".bss", Section::BSS));
-    sectionSpecifications.push_back(
-        SectionSpecification(".rodata", Section::RODATA));
-
-    definitionSpecifications.push_back(DefinitionSpecification(".char", 1));
-    definitionSpecifications.push_back(DefinitionSpecification(".word", 2));
-    definitionSpecifications.push_back(DefinitionSpecification(".long", 4));
-
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("add", 0x30));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("addeq", 0x00));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("addne", 0x10));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("addgt", 0x20));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("addal", 0x30));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("sub", 0x31));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("subeq", 0x01));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("subne", 0x11));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("subgt", 0x21));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("subal", 0x31));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("mul", 0x32));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("muleq", 0x02));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("mulne", 0x12));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("mulgt", 0x22));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("mulal", 0x32));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("div", 0x33));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("diveq", 0x03));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("divne", 0x13));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("divgt", 0x23));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("dival", 0x33));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("cmp", 0x34));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("cmpeq", 0x04));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("cmpne", 0x14));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("cmpgt", 0x24));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("cmpal", 0x34));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("and", 0x35));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("andeq", 0x05));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("andne", 0x15));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("andgt", 0x25));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("andal", 0x35));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("or", 0x36));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("oreq", 0x06));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("orne", 0x16));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("orgt", 0x26));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("oral", 0x36));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("not", 0x37));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("noteq", 0x07));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("notne", 0x17));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("notgt", 0x27));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("notal", 0x37));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("test", 0x38));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("testeq", 0x08));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("testne", 0x18));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("testgt", 0x28));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("testal", 0x38));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("mov", 0x3D));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("moveq", 0x0D));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("movne", 0x1D));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("movgt", 0x2D));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("moval", 0x3D));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shl", 0x3E));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shleq", 0x0E));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shlne", 0x1E));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shlgt", 0x2E));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shlal", 0x3E));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shr", 0x3F));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shreq", 0x0F));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shrne", 0x1F));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shrgt", 0x2F));
-    doubleAddressInstructionSpecs.push_back(
-        InstructionSpecification("shral", 0x3F));
-
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("push", 0x39, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("pusheq", 0x09, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("pushne", 0x19, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("pushgt", 0x29, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("pushal", 0x39, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("pop", 0x3A));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("popeq", 0x0A));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("popne", 0x1A));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("popgt", 0x2A));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("popal", 0x3A));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("call", 0x3B, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("calleq", 0x0B, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("callne", 0x1B, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("callgt", 0x2B, false));
-    singleAddressInstructionSpecs.push_back(
-        InstructionSpecification("callal", 0x3B, false));
-
-    noAddressInstructionSpecs.push_back(InstructionSpecification("iret", 0x3C));
-    noAddressInstructionSpecs.push_back(
-        InstructionSpecification("ireteq", 0x0C));
-    noAddressInstructionSpecs.push_back(
-        InstructionSpecification("iretne", 0x1C));
-    noAddressInstructionSpecs.push_back(
-        InstructionSpecification("iretgt", 0x2C));
-    noAddressInstructionSpecs.push_back(
-        InstructionSpecification("iretal", 0x3C));
-
-    retInstructionSpecs.push_back(InstructionSpecification("ret", 0x3A));
-    retInstructionSpecs.push_back(InstructionSpecification("reteq", 0x0A));
-    retInstructionSpecs.push_back(InstructionSpecification("retne", 0x1A));
-    retInstructionSpecs.push_back(InstructionSpecification("retgt", 0x2A));
-    retInstructionSpecs.push_back(InstructionSpecification("retal", 0x3A));
-
-    jmpInstructionSpecs.push_back(InstructionSpecification("jmp", 0x03));
-    jmpInstructionSpecs.push_back(InstructionSpecification("jmpeq", 0x00));
-    jmpInstructionSpecs.push_back(InstructionSpecification("jmpne", 0x01));
-    jmpInstructionSpecs.push_back(InstructionSpecification("jmpgt", 0x02));
-    jmpInstructionSpecs.push_back(InstructionSpecification("jmpal", 0x03));
-}
-
-Command Recognizer::recognizeCommand(TokenStream& tokenStream) const {
-    auto token = tokenStream.next();
-    while (token.getType() == Token::LINE_DELIMITER) {
-        token = tokenStream.next();
-    }
-    if (token.getType() == Token::LABEL) {
-        return Command(token.getValue(), Command::LABEL);
-    }
-    if (isGlobalDirective(token)) {
-        return Command(token.getValue(), Command::GLOBAL_DIR);
-    }
-    if (isEndDirective(token)) {
-        return Command(token.getValue(), Command::END_DIR);
-    }
-    if (isAlignDirective(token)) {
-        return Command(token.getValue(), Command::ALIGN_DIR);
-    }
-    if (isSkipDirective(token)) {
-        return Command(token.getValue(), Command::SKIP_DIR);
+const Recognizer::SectionSpecification
+    Recognizer::sectionSpecifications[] = {{".data", Section::DATA},
+                                           {".text", Section::TEXT},
+                                           {".bss", Section::BSS},
+                                           {".rodata", Section::RODATA}};
+
+const Recognizer::DefinitionSpecification
+    Recognizer::definitionSpecifications[] = {
+        {".char", 1}, {".word", 2}, {".long", 4}};
+
+const Recognizer::StringSpecification Recognizer::stringSpecifications[] = {
+    {".ascii", false}, {".asciz", true}};
+
+const array<Recognizer::Keyword, Recognizer::KEYWORD_SLOTS>
+    Recognizer::keywords = constructKeywords();
+
+array<Recognizer::Keyword, Recognizer::KEYWORD_SLOTS>
+Recognizer::constructKeywords() {
+    array<Keyword, KEYWORD_SLOTS> slots;
+    slots.fill(Keyword{nullptr, "", Command::EMPTY, -1});
+    addKeyword(slots, Keyword{".global", "", Command::GLOBAL_DIR, -1});
+    addKeyword(slots, Keyword{".end", "", Command::END_DIR, -1});
+    addKeyword(slots, Keyword{".align", "", Command::ALIGN_DIR, -1});
+    addKeyword(slots, Keyword{".skip", "", Command::SKIP_DIR, -1});
+    addKeyword(slots, Keyword{".incbin", "", Command::INCBIN_DIR, -1});
+    for (auto&& ss : sectionSpecifications) {
+        addKeyword(slots, Keyword{ss.name, "", Command::SECTION,
+                                  int(&ss - sectionSpecifications)});
     }
-    if (isSection(token)) {
-        return Command(token.getValue(), Command::SECTION);
+    for (auto&& ds : definitionSpecifications) {
+        addKeyword(slots, Keyword{ds.name, "", Command::DEFINITION,
+                                  int(&ds - definitionSpecifications)});
     }
-    if (isDefinition(token)) {
-        return Command(token.getValue(), Command::DEFINITION);
+    for (auto&& ss : stringSpecifications) {
+        addKeyword(slots, Keyword{ss.name, "", Command::STRING_DIR,
+                                  int(&ss - stringSpecifications)});
     }
-    if (isInstruction(token)) {
-        return Command(token.getValue(), Command::INSTRUCTION);
+    for (auto i = 0; i < Isa::INSTRUCTION_COUNT; i++) {
+        const auto& is = Instructions::SPECIFICATIONS[i];
+        addKeyword(slots, Keyword{is.name, is.suffix, Command::INSTRUCTION, i});
     }
-    throw UnknownCommandException(token.getValue());
+    return slots;
 }
 
-bool Recognizer::isGlobalDirective(const Token& token) const {
-    auto v = token.getValue();
-    return token.getType() == Token::IDENTIFICATOR &&
-           (v == ".global" || v == ".GLOBAL");
-}
-
-bool Recognizer::isEndDirective(const Token& token) const {
-    auto v = token.getValue();
-    return token.getType() == Token::IDENTIFICATOR &&
-           (v == ".end" || v == ".END");
+void Recognizer::addKeyword(array<Keyword, KEYWORD_SLOTS>& slots,
+                            const Keyword& keyword) {
+    // Table is kept at most half full, which keeps probe chains short
+    static_assert(Isa::INSTRUCTION_COUNT + 14 <= KEYWORD_SLOTS / 2,
+                  "Keyword table is too small");
+    auto slot = hashKeyword(keyword.name, keyword.suffix) % KEYWORD_SLOTS;
+    while (slots[slot].name) {
+        slot = (slot + 1) % KEYWORD_SLOTS;
+    }
+    slots[slot] = keyword;
 }
 
-bool Recognizer::isAlignDirective(const Token& token) const {
-    auto v = token.getValue();
-    return token.getType() == Token::IDENTIFICATOR &&
-           (v == ".align" || v == ".ALIGN");
+int Recognizer::findKeyword(const StringRef& name) {
+    for (auto slot = hashKeyword(name) % KEYWORD_SLOTS; keywords[slot].name;
+         slot = (slot + 1) % KEYWORD_SLOTS) {
+        if (matchesKeyword(name, keywords[slot])) {
+            return slot;
+        }
+    }
+    return Command::NO_KEYWORD;
 }
 
-bool Recognizer::isSkipDirective(const Token& token) const {
-    auto v = token.getValue();
-    return token.getType() == Token::IDENTIFICATOR &&
-           (v == ".skip" || v == ".SKIP");
+const Recognizer::Keyword& Recognizer::getKeyword(const Command& comm,
+                                                  Command::Type type) {
+    if (comm.keyword == Command::NO_KEYWORD ||
+        keywords[comm.keyword].type != type) {
+        throw SystemException("Command " + comm.name +
+                              " wasn't recognized as expected");
+    }
+    return keywords[comm.keyword];
 }
 
-bool Recognizer::isSection(const Token& token) const {
-    if (token.getType() != Token::IDENTIFICATOR) {
-        return false;
-    }
-    auto v = token.getValue();
-    for (auto&& sp : sectionSpecifications) {
-        if (v == sp.name || v == Utils::uppercaseString(sp.name)) {
-            return true;
+// FNV-1a over the characters folded to lower case
+std::size_t Recognizer::hashKeyword(const StringRef& name, std::size_t hash) {
+    for (auto c : name) {
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
         }
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
     }
-    return false;
+    return hash;
 }
 
-bool Recognizer::isDefinition(const Token& token) const {
-    if (token.getType() != Token::IDENTIFICATOR) {
-        return false;
-    }
-    auto v = token.getValue();
-    for (auto&& df : definitionSpecifications) {
-        if (v == df.name || v == Utils::uppercaseString(df.name)) {
-            return true;
-        }
-    }
-    return false;
+std::size_t Recognizer::hashKeyword(const char* name, const char* suffix) {
+    return hashKeyword(suffix, hashKeyword(name));
 }
 
-bool Recognizer::isInstruction(const Token& token) const {
-    if (token.getType() != Token::IDENTIFICATOR) {
-        return false;
-    }
-    auto key = token.getValue();
-    for (auto&& sais : singleAddressInstructionSpecs) {
-        if (key == sais.name || key == Utils::uppercaseString(sais.name)) {
-            return true;
-        }
-    }
-    for (auto&& dais : doubleAddressInstructionSpecs) {
-        if (key == dais.name || key == Utils::uppercaseString(dais.name)) {
-            return true;
-        }
-    }
-    for (auto&& nais : noAddressInstructionSpecs) {
-        if (key == nais.name || key == Utils::uppercaseString(nais.name)) {
-            return true;
-        }
+// Keyword names are stored in lower case, the whole name is written either
+// in lower or in upper case
+bool Recognizer::matchesKeyword(const StringRef& text,
+                                const Keyword& keyword) {
+    auto lower = true;
+    auto upper = true;
+    auto i = 0u;
+    for (auto part : {keyword.name, keyword.suffix}) {
+        for (; *part; part++, i++) {
+            if (i == text.size()) {
+                return false;
+            }
+            auto c = *part;
+            lower = lower && text[i] == c;
+            upper = upper &&
+                    text[i] == (c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+            if (!lower && !upper) {
+                return false;
+            }
+        }
+    }
+    return i == text.size();
+}
+
+Command Recognizer::recognizeCommand(TokenStream& tokenStream) const {
+    auto token = tokenStream.next();
+    while (token.getType() == Token::LINE_DELIMITER) {
+        token = tokenStream.next();
     }
-    for (auto&& retis : retInstructionSpecs) {
-        if (key == retis.name || key == Utils::uppercaseString(retis.name)) {
-            return true;
-        }
+    if (token.getType() == Token::LABEL) {
+        return Command(token.getText(), Command::LABEL, Command::NO_KEYWORD,
+                       token.getId());
     }
-    for (auto&& jmpis : jmpInstructionSpecs) {
-        if (key == jmpis.name || key == Utils::uppercaseString(jmpis.name)) {
-            return true;
+    if (token.getType() == Token::IDENTIFICATOR) {
+        auto keyword = findKeyword(token.getText());
+        if (keyword != Command::NO_KEYWORD) {
+            return Command(token.getText(), keywords[keyword].type, keyword,
+                           token.getId());
         }
     }
-    return false;
+    throw UnknownCommandException(token.getValue());
 }
 
 Section* Recognizer::recognizeSection(const Command& comm,
                                       TokenStream& tokenStream,
-                                      unsigned int address) const {
+                                      unsigned int address,
+                                      Arena& arena) const {
     auto t = tokenStream.next();
     if (t.getType() != Token::LINE_DELIMITER) {
         throw DecodingException("Invalid character " + t.getValue() +
                                 " after section definition");
     }
-    for (auto&& ss : sectionSpecifications) {
-        if (ss.name == comm.name ||
-            Utils::uppercaseString(ss.name) == comm.name) {
-            return new Section(comm.name, ss.type, address);
-        }
+    if (comm.keyword == Command::NO_KEYWORD ||
+        keywords[comm.keyword].type != Command::SECTION) {
+        throw DecodingException("Unknown section name " + comm.name);
     }
-    throw DecodingException("Unknown section name " + comm.name);
+    const auto& ss = sectionSpecifications[keywords[comm.keyword].spec];
+    return arena.create<Section>(comm.name.str(), comm.id, ss.type, address);
 }
 
-vector<string> Recognizer::recognizeGlobalSymbols(
+const Token* Recognizer::findSectionEnd(const Token* begin,
+                                        const Token* end) const {
+    auto lineStart = true;
+    for (auto t = begin; t != end; ++t) {
+        if (lineStart && t->getType() != Token::LINE_DELIMITER) {
+            auto command =
+                t->getType() == Token::LABEL && t + 1 != end ? t + 1 : t;
+            if (command->getType() == Token::IDENTIFICATOR) {
+                auto keyword = findKeyword(command->getText());
+                if (keyword != Command::NO_KEYWORD &&
+                    (keywords[keyword].type == Command::SECTION ||
+                     keywords[keyword].type == Command::END_DIR)) {
+                    return t;
+                }
+            }
+        }
+        lineStart = t->getType() == Token::LINE_DELIMITER;
+    }
+    return end;
+}
+
+vector<int> Recognizer::recognizeGlobalSymbols(
     TokenStream& tokenStream) const {
     auto firstToken = tokenStream.next();
     auto secondToken = tokenStream.next();
-    vector<string> symbols;
+    vector<int> symbols;
     while (true) {
         if (firstToken.getType() != Token::IDENTIFICATOR) {
             throw DecodingException("Invalid character " +
                                     firstToken.getValue() +
                                     " in global symbol decl");
         }
-        symbols.push_back(firstToken.getValue());
+        symbols.push_back(firstToken.getId());
         if (secondToken.getType() == Token::LINE_DELIMITER) {
             return symbols;
         }
@@ -361,50 +216,23 @@ Definition Recognizer::recognizeDefinition(const Command& comm) const {
         throw SystemException(
             "Invalid command type for definition for command " + comm.name);
     }
-    for (auto&& d : definitionSpecifications) {
-        if (d.name == comm.name ||
-            Utils::uppercaseString(d.name) == comm.name) {
-            return Definition(d.name, d.size);
-        }
-    }
-    throw SystemException("Unknown definition name " + comm.name);
+    const auto& d =
+        definitionSpecifications[getKeyword(comm, Command::DEFINITION).spec];
+    return Definition(d.name, d.size);
+}
+
+StringDirective Recognizer::recognizeString(const Command& comm) const {
+    return StringDirective(
+        stringSpecifications[getKeyword(comm, Command::STRING_DIR).spec]
+            .terminated);
 }
 
-Instruction* Recognizer::recognizeInstruction(const Command& comm) const {
+const Isa::InstructionSpecification& Recognizer::recognizeInstruction(
+    const Command& comm) const {
     if (comm.type != Command::INSTRUCTION) {
         throw SystemException(
             "Invalid command type for instruction for command " + comm.name);
     }
-    for (auto&& sais : singleAddressInstructionSpecs) {
-        if (sais.name == comm.name ||
-            Utils::uppercaseString(sais.name) == comm.name) {
-            return new SingleAddressInstruction(sais.name, sais.opcode,
-                                                sais.dst);
-        }
-    }
-    for (auto&& dais : doubleAddressInstructionSpecs) {
-        if (dais.name == comm.name ||
-            Utils::uppercaseString(dais.name) == comm.name) {
-            return new DoubleAddressInstruction(dais.name, dais.opcode);
-        }
-    }
-    for (auto&& nais : noAddressInstructionSpecs) {
-        if (nais.name == comm.name ||
-            Utils::uppercaseString(nais.name) == comm.name) {
-            return new NoAddressInstruction(nais.name, nais.opcode);
-        }
-    }
-    for (auto&& ris : retInstructionSpecs) {
-        if (ris.name == comm.name ||
-            Utils::uppercaseString(ris.name) == comm.name) {
-            return new RetInstruction(ris.name, ris.opcode);
-        }
-    }
-    for (auto&& jis : jmpInstructionSpecs) {
-        if (jis.name == comm.name ||
-            Utils::uppercaseString(jis.name) == comm.name) {
-            return new JmpInstruction(jis.name, jis.opcode);
-        }
-    }
-    throw SystemException("No instruction found with name " + comm.name);
+    return Instructions::SPECIFICATIONS[getKeyword(comm, Command::INSTRUCTION)
+                                            .spec];
 }
\ No newline at end of file
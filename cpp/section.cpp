@@ -1,43 +1,112 @@
 #include "section.h"
 #include <ostream>
+#include <string>
+#include <vector>
+#include "hex_emitter.h"
 using std::endl;
 using std::ostream;
+using std::string;
 using std::vector;
 
-const Section& Section::writeRelData(ostream& os) const {
+// A run costs about as much as this many encoded bytes
+const std::size_t Section::MIN_FILL_LENGTH = 0x20;
+
+void Section::addFill(unsigned char byte, std::size_t length) {
     if (type == BSS) {
-        return *this;
+        if (byte) {
+            throw DecodingException(
+                "BSS section can only contain uninitalized data");
+        }
+        return;
     }
-    os << "#.rel" << name << endl << "#ofset\ttip\tvrednost" << endl;
-    for (auto&& r : relocations) {
-        os << r;
+    if (length < MIN_FILL_LENGTH) {
+        content.insert(content.end(), length, byte);
+        return;
     }
-    return *this;
+    auto offset = getContentSize();
+    if (!runs.empty() && !runs.back().data && runs.back().byte == byte &&
+        runs.back().offset + runs.back().length == offset) {
+        runs.back().length += length;
+    } else {
+        runs.push_back(Run(offset, length, byte));
+    }
+    runSize += length;
 }
 
-const Section& Section::writeContent(ostream& os) const {
+void Section::addExternal(const unsigned char* data, std::size_t length) {
     if (type == BSS) {
-        return *this;
+        throw DecodingException(
+            "BSS section can only contain uninitalized data");
     }
-    os << '#' << name << endl;
-    auto counter = 0;
-    for (auto&& ins : instructions) {
-        counter = ins->write(os, counter);
+    if (length) {
+        runs.push_back(Run(getContentSize(), length, data));
+        runSize += length;
+    }
+}
+
+bool Section::hasExternalRuns() const {
+    for (auto&& r : runs) {
+        if (r.data) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Section::setContent(const vector<unsigned char>& encoded,
+                         const vector<Run>& encodedRuns) {
+    content = encoded;
+    runs = encodedRuns;
+    runSize = 0;
+    for (auto&& r : runs) {
+        runSize += r.length;
+    }
+}
+
+const Section& Section::writeRelData(ostream& os) const {
+    if (type != BSS) {
+        writeRelData(os, name, relocations.data(),
+                     relocations.data() + relocations.size());
     }
-    if (counter % 16) {
-        os << endl;
+    return *this;
+}
+
+const Section& Section::writeContent(ostream& os) const {
+    if (type != BSS) {
+        os << '#' << name << endl;
+        HexEmitter emitter(os);
+        forEachRun(
+            [&emitter](const unsigned char* begin, const unsigned char* end) {
+                emitter.writeBytes(begin, end);
+            },
+            [&emitter](unsigned char byte, std::size_t length) {
+                emitter.writeFill(byte, length);
+            });
+        emitter.endLine();
     }
     return *this;
 }
 
+void Section::writeRelData(ostream& os, const string& name,
+                           const RelocationData* begin,
+                           const RelocationData* end) {
+    os << "#.rel" << name << endl << "#ofset\ttip\tvrednost" << endl;
+    for (auto r = begin; r != end; r++) {
+        os << *r;
+    }
+}
+
+void Section::writeContent(ostream& os, const string& name,
+                           const unsigned char* begin,
+                           const unsigned char* end) {
+    os << '#' << name << endl;
+    HexEmitter emitter(os);
+    emitter.writeBytes(begin, end);
+    emitter.endLine();
+}
+
 void Section::addRelocationData(const vector<RelocationData>& relData) {
     for (auto&& r : relData) {
         relocations.push_back(r);
     }
 }
-
-Section::~Section() {
-    for (auto&& ins : instructions) {
-        delete ins;
-    }
-}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "section_cache.h"
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "cache_file.h"
+#include "data.h"
+#include "exceptions_a.h"
+#include "section.h"
+#include "token.h"
+using std::int32_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+const char SectionCache::MAGIC[4] = {'A', 'C', 'C', 'H'};
+const uint32_t SectionCache::VERSION = 3;
+
+SectionCache::SectionCache(const string& directory,
+                           const string& sourceFileName) {
+    std::ostringstream name;
+    name << directory << '/' << std::hex
+         << hash(sourceFileName, 0, nullptr, nullptr) << ".cache";
+    fileName = name.str();
+
+    string file;
+    if (!CacheFile::load(fileName, file)) {
+        return;
+    }
+    try {
+        load(file.data(), file.data() + file.size());
+    } catch (const SystemException&) {
+        loaded.clear();
+    }
+}
+
+uint64_t SectionCache::hash(const string& sectionName, int address,
+                            const Token* begin, const Token* end) {
+    // FNV-1a, with separators so that adjacent fields can't run together
+    uint64_t result = 14695981039346656037ull;
+    auto add = [&result](const char* bytes, std::size_t size) {
+        for (auto i = 0u; i < size; i++) {
+            result = (result ^ static_cast<unsigned char>(bytes[i])) *
+                     1099511628211ull;
+        }
+    };
+    add(sectionName.data(), sectionName.size() + 1);
+    add(reinterpret_cast<const char*>(&address), sizeof(address));
+    for (auto t = begin; t != end; ++t) {
+        char type = t->getType();
+        add(&type, 1);
+        add(t->getText().data(), t->getText().size());
+    }
+    return result;
+}
+
+const SectionCache::Entry* SectionCache::find(uint64_t key) const {
+    auto it = loaded.find(key);
+    return it == loaded.end() ? nullptr : &it->second;
+}
+
+void SectionCache::put(const Entry& entry) { entries.push_back(entry); }
+
+void SectionCache::save() const {
+    vector<char> file(MAGIC, MAGIC + sizeof(MAGIC));
+    CacheFile::append(file, VERSION);
+    CacheFile::append(file, uint32_t(entries.size()));
+    for (auto&& e : entries) {
+        CacheFile::append(file, e.key);
+        CacheFile::append(file, e.address);
+        CacheFile::append(file, e.size);
+        CacheFile::append(file, e.sectionNumber);
+        CacheFile::append(file, uint32_t(e.labels.size()));
+        for (auto&& l : e.labels) {
+            CacheFile::append(file, l.name);
+            CacheFile::append(file, l.offset);
+        }
+        CacheFile::append(file, uint32_t(e.dependencies.size()));
+        for (auto&& d : e.dependencies) {
+            CacheFile::append(file, d.name);
+            CacheFile::append(file, d.address);
+            CacheFile::append(file, d.section);
+            CacheFile::append(file, d.scope);
+            CacheFile::append(file, d.number);
+        }
+        CacheFile::append(file, uint32_t(e.content.size()));
+        file.insert(file.end(), e.content.begin(), e.content.end());
+        CacheFile::append(file, uint32_t(e.runs.size()));
+        for (auto&& r : e.runs) {
+            CacheFile::append(file, uint32_t(r.offset));
+            CacheFile::append(file, uint32_t(r.length));
+            CacheFile::append(file, r.byte);
+        }
+        CacheFile::append(file, uint32_t(e.relocations.size()));
+        for (auto&& r : e.relocations) {
+            CacheFile::append(file, uint32_t(r.getOffset()));
+            CacheFile::append(file, uint32_t(r.getType()));
+            CacheFile::append(file, uint32_t(r.getValue()));
+        }
+    }
+
+    CacheFile::save(fileName, file);
+}
+
+void SectionCache::load(const char* begin, const char* end) {
+    auto current = begin;
+    if (end - begin < 4 || std::memcmp(begin, MAGIC, sizeof(MAGIC))) {
+        throw SystemException("Corrupted section cache");
+    }
+    current += sizeof(MAGIC);
+    if (CacheFile::read<uint32_t>(current, end) != VERSION) {
+        return;
+    }
+    auto entryCount = CacheFile::read<uint32_t>(current, end);
+    for (auto i = 0u; i < entryCount; i++) {
+        Entry e;
+        e.key = CacheFile::read<uint64_t>(current, end);
+        e.address = CacheFile::read<int32_t>(current, end);
+        e.size = CacheFile::read<uint32_t>(current, end);
+        e.sectionNumber = CacheFile::read<int32_t>(current, end);
+        auto labelCount = CacheFile::read<uint32_t>(current, end);
+        for (auto j = 0u; j < labelCount; j++) {
+            Label l;
+            l.name = CacheFile::readString(current, end);
+            l.offset = CacheFile::read<int32_t>(current, end);
+            e.labels.push_back(l);
+        }
+        auto dependencyCount = CacheFile::read<uint32_t>(current, end);
+        for (auto j = 0u; j < dependencyCount; j++) {
+            Dependency d;
+            d.name = CacheFile::readString(current, end);
+            d.address = CacheFile::read<int32_t>(current, end);
+            d.section = CacheFile::read<int32_t>(current, end);
+            d.scope = CacheFile::read<uint32_t>(current, end);
+            d.number = CacheFile::read<uint32_t>(current, end);
+            e.dependencies.push_back(d);
+        }
+        auto contentSize = CacheFile::read<uint32_t>(current, end);
+        if (contentSize > uint32_t(end - current)) {
+            throw SystemException("Corrupted section cache");
+        }
+        e.content.assign(current, current + contentSize);
+        current += contentSize;
+        auto runCount = CacheFile::read<uint32_t>(current, end);
+        for (auto j = 0u; j < runCount; j++) {
+            auto offset = CacheFile::read<uint32_t>(current, end);
+            auto length = CacheFile::read<uint32_t>(current, end);
+            auto byte = CacheFile::read<unsigned char>(current, end);
+            e.runs.push_back(Section::Run(offset, length, byte));
+        }
+        auto relocationCount = CacheFile::read<uint32_t>(current, end);
+        for (auto j = 0u; j < relocationCount; j++) {
+            auto offset = CacheFile::read<uint32_t>(current, end);
+            auto type = CacheFile::read<uint32_t>(current, end);
+            auto value = CacheFile::read<uint32_t>(current, end);
+            e.relocations.push_back(RelocationData(
+                offset, RelocationData::Type(type), value));
+        }
+        validate(e);
+        loaded[e.key] = e;
+    }
+}
+
+void SectionCache::validate(const Entry& e) {
+    // Sections copy the runs between the encoded bytes, so they must be in
+    // order, apart and within the content
+    uint64_t inRuns = 0;
+    uint64_t previousEnd = 0;
+    for (auto&& r : e.runs) {
+        if (r.offset < previousEnd || r.offset - inRuns > e.content.size()) {
+            throw SystemException("Corrupted section cache");
+        }
+        inRuns += r.length;
+        previousEnd = uint64_t(r.offset) + r.length;
+    }
+    if (e.address < 0 || e.content.size() + inRuns > e.size) {
+        throw SystemException("Corrupted section cache");
+    }
+    for (auto&& l : e.labels) {
+        if (l.offset < 0 || uint32_t(l.offset) > e.size) {
+            throw SystemException("Corrupted section cache");
+        }
+    }
+    // Relocation offsets are addresses, the section starts at its address
+    for (auto&& r : e.relocations) {
+        if (r.getOffset() < uint32_t(e.address) ||
+            r.getOffset() - e.address >= e.size ||
+            r.getType() > RelocationData::RELATIVE) {
+            throw SystemException("Corrupted section cache");
+        }
+    }
+}
@@ -1,7 +1,11 @@
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "assembler.h"
+#include "batch.h"
+#include "object_file.h"
 using std::cout;
 using std::endl;
 using std::ifstream;
@@ -9,26 +13,114 @@ using std::string;
 using std::vector;
 
 int main(int argc, char** argv) {
-    // Arguments check
-    if (argc < 3 || argc > 4) {
+    // Options precede the file names
+    auto format = Assembler::TEXT;
+    auto dump = false;
+    auto batch = false;
+    // Batch jobs assembled in parallel, -1 if the -j option is invalid
+    auto threadCount = 1;
+    auto threadsGiven = false;
+    // Section cache, empty if there is none
+    string cacheDirectory;
+    auto cacheGiven = false;
+    vector<string> arguments;
+    for (auto i = 1; i < argc; i++) {
+        string argument = argv[i];
+        if (arguments.empty() && argument == "--binary") {
+            format = Assembler::BINARY;
+        } else if (arguments.empty() && argument == "--dump") {
+            dump = true;
+        } else if (arguments.empty() && argument == "--batch") {
+            batch = true;
+        } else if (arguments.empty() && argument == "--cache") {
+            cacheGiven = true;
+            if (i + 1 < argc) {
+                cacheDirectory = argv[++i];
+            }
+        } else if (arguments.empty() && argument == "-j") {
+            threadsGiven = true;
+            threadCount = -1;
+            if (i + 1 < argc) {
+                char* end;
+                auto count = std::strtol(argv[++i], &end, 10);
+                if (*end == '\0' && count >= 0 && count <= 1024) {
+                    threadCount = count;
+                }
+            }
+        } else {
+            arguments.push_back(argument);
+        }
+    }
+
+    // Arguments check, a batch takes a response file or file pairs
+    auto argumentsValid =
+        batch ? !dump && threadCount >= 0 &&
+                    (arguments.size() == 1 ||
+                     (arguments.size() >= 2 && arguments.size() % 2 == 0))
+              : !threadsGiven && arguments.size() >= 2 &&
+                    arguments.size() <= (dump ? 2 : 3) &&
+                    !(dump && format == Assembler::BINARY);
+    if (cacheGiven && (cacheDirectory.empty() || dump)) {
+        argumentsValid = false;
+    }
+    if (!argumentsValid) {
         cout << "\nCall to the program must be in format [OPTIONAL]:\n\n\t "
-                "assembler.out INPUT_FILE OUTPUT_FILE [START_ADDRESS]\n"
+                "assembler.out [--binary] [--cache DIRECTORY] INPUT_FILE "
+                "OUTPUT_FILE [START_ADDRESS]\n\t "
+                "assembler.out --dump OBJECT_FILE OUTPUT_FILE\n\t "
+                "assembler.out [--binary] [--cache DIRECTORY] [-j N] --batch "
+                "RESPONSE_FILE\n\t "
+                "assembler.out [--binary] [--cache DIRECTORY] [-j N] --batch "
+                "INPUT_FILE OUTPUT_FILE [INPUT_FILE OUTPUT_FILE]...\n\n"
+                "Use - as the INPUT_FILE to read the source from stdin.\n"
+                "--binary writes a binary object file, --dump converts one "
+                "to the text format.\n"
+                "A response file lists one INPUT_FILE OUTPUT_FILE "
+                "[START_ADDRESS] per line.\n"
+                "-j assembles a batch on N threads, 0 means one per core.\n"
+                "--cache keeps the encoded sections in the directory and "
+                "reuses the unchanged ones.\n"
              << std::endl;
         return -1;
     }
 
     try {
+        if (batch) {
+            vector<Batch::Job> jobs;
+            if (arguments.size() == 1) {
+                jobs = Batch::readResponseFile(arguments[0]);
+            } else {
+                for (auto i = 0u; i < arguments.size(); i += 2) {
+                    jobs.push_back(Batch::Job(arguments[i], arguments[i + 1]));
+                }
+            }
+            Assembler as(cacheDirectory);
+            auto failed = Batch::run(as, jobs, format, cout, threadCount);
+            if (failed) {
+                cout << "\nBATCH ASSEMBLY FAILED FOR " << failed << " OF "
+                     << jobs.size() << " FILES" << endl;
+                return -3;
+            }
+            cout << "BATCH ASSEMBLY SUCCESSFULL" << endl;
+            return 0;
+        }
+
         // Argument unwrapping
-        auto inputFileName = argv[1];
-        auto outputFileName = argv[2];
+        auto inputFileName = arguments[0];
+        auto outputFileName = arguments[1];
+        if (dump) {
+            ObjectFile::dumpFile(inputFileName, outputFileName);
+            cout << "FILE DUMP SUCCESSFULL" << endl;
+            return 0;
+        }
         auto startAddress = 0;
-        if (argc == 4) {
-            startAddress = std::stoi(argv[3], 0, 0);
+        if (arguments.size() == 3) {
+            startAddress = std::stoi(arguments[2], 0, 0);
         }
 
         // Assemly of a file
-        Assembler as;
-        as.assembleFile(inputFileName, outputFileName, startAddress);
+        Assembler as(cacheDirectory);
+        as.assembleFile(inputFileName, outputFileName, startAddress, format);
         cout << "FILE ASSEMBLY SUCCESSFULL" << endl;
 
     } catch (const ifstream::failure& f) {
@@ -43,4 +135,4 @@ int main(int argc, char** argv) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+#include "source_buffer.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include "exceptions_a.h"
+using std::istream;
+using std::string;
+
+const string SourceBuffer::STDIN_NAME = "-";
+const std::size_t SourceBuffer::READ_BLOCK_SIZE = 0x10000;
+
+SourceBuffer::SourceBuffer(const string& fileName)
+    : data(nullptr), length(0), mapped(false) {
+    if (fileName == STDIN_NAME) {
+        read(std::cin);
+        return;
+    }
+
+    auto fileDescriptor = open(fileName.c_str(), O_RDONLY);
+    if (fileDescriptor == -1) {
+        throw SystemException("Unable to open input file " + fileName);
+    }
+    try {
+        // Non-seekable input, e.g. a named pipe, is read from the open
+        // descriptor, reopening it would lose what was already written
+        if (!map(fileDescriptor, fileName)) {
+            read(fileDescriptor, fileName);
+        }
+    } catch (...) {
+        close(fileDescriptor);
+        throw;
+    }
+    close(fileDescriptor);
+}
+
+SourceBuffer::SourceBuffer(istream& input)
+    : data(nullptr), length(0), mapped(false) {
+    read(input);
+}
+
+SourceBuffer::~SourceBuffer() {
+    if (mapped) {
+        munmap(const_cast<char*>(data), length);
+    }
+}
+
+bool SourceBuffer::map(int fileDescriptor, const string& fileName) {
+    struct stat info;
+    if (fstat(fileDescriptor, &info) == -1) {
+        throw SystemException("Unable to stat input file " + fileName);
+    }
+    if (!S_ISREG(info.st_mode)) {
+        return false;
+    }
+    if (info.st_size == 0) {
+        data = storage.data();
+        return true;
+    }
+    auto address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                        fileDescriptor, 0);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    madvise(address, info.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(address);
+    length = info.st_size;
+    mapped = true;
+    return true;
+}
+
+void SourceBuffer::release(const char* begin, const char* end) const {
+    if (!mapped) {
+        return;
+    }
+    // Whole pages only, the mapping itself starts at a page boundary
+    auto pageSize = sysconf(_SC_PAGESIZE);
+    auto first = (begin - data) / pageSize * pageSize;
+    auto last = (end - data) / pageSize * pageSize;
+    if (first < last) {
+        madvise(const_cast<char*>(data) + first, last - first, MADV_DONTNEED);
+    }
+}
+
+void SourceBuffer::read(int fileDescriptor, const string& fileName) {
+    // Read straight into the storage, which grows a block at a time
+    while (true) {
+        auto size = storage.size();
+        storage.resize(size + READ_BLOCK_SIZE);
+        auto count = ::read(fileDescriptor, &storage[size], READ_BLOCK_SIZE);
+        storage.resize(size + (count > 0 ? count : 0));
+        if (count == 0) {
+            break;
+        }
+        if (count == -1 && errno != EINTR) {
+            throw SystemException("Unable to read input file " + fileName);
+        }
+    }
+    data = storage.data();
+    length = storage.size();
+}
+
+void SourceBuffer::read(istream& input) {
+    storage.assign(std::istreambuf_iterator<char>(input),
+                   std::istreambuf_iterator<char>());
+    data = storage.data();
+    length = storage.size();
+}
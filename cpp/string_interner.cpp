@@ -0,0 +1,16 @@
+#include "string_interner.h"
+#include <string>
+#include "string_ref.h"
+
+const int StringInterner::NO_ID = -1;
+
+int StringInterner::intern(const StringRef& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    int id = names.size();
+    names.push_back(name.str());
+    ids.emplace(StringRef(names.back()), id);
+    return id;
+}
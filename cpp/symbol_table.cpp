@@ -9,96 +9,80 @@ using std::vector;
 
 const int SymbolTable::UNKNOWN_SECTION = 0;
 const int SymbolTable::UNKNOWN_ADDRESS = 0;
+const int SymbolTable::NO_INDEX = -1;
 
-void SymbolTable::putSection(const string& name, unsigned int address) {
-    for (auto&& section : sections) {
-        if (section.name == name) {
-            throw SymbolAlreadyDefinedException(section.name);
-        }
+void SymbolTable::putSection(int id, unsigned int address) {
+    auto& index = getIndex(sectionIndexes, id);
+    if (index != NO_INDEX) {
+        throw SymbolAlreadyDefinedException(interner->getName(id));
     }
-    sections.push_back(Section(name, address, sections.size() + 1, 0));
+    index = sections.size();
+    sections.push_back(
+        Section(interner->getName(id), id, address, sections.size() + 1, 0));
     lastSection++;
 }
 
-void SymbolTable::putSymbol(const string& name, int address, Scope scope,
-                            int section) {
+void SymbolTable::putSymbol(int id, int address, Scope scope, int section) {
     if (section == -2) {
         if (lastSection == 0) {
-            throw NoSectionDefined(name);
+            throw NoSectionDefined(interner->getName(id));
         }
         section = lastSection;
     }
-    for (auto&& symbol : symbols) {
-        if (symbol.name == name) {
-            throw SymbolAlreadyDefinedException(symbol.name);
-        }
+    auto& index = getIndex(symbolIndexes, id);
+    if (index != NO_INDEX) {
+        throw SymbolAlreadyDefinedException(interner->getName(id));
     }
-    symbols.push_back(Symbol(name, section, scope, address, symbols.size()));
+    index = symbols.size();
+    symbols.push_back(Symbol(interner->getName(id), id, section, scope,
+                             address, symbols.size()));
 }
 
-bool SymbolTable::updateScope(const string& name, Scope newScope) {
-    for (auto& symbol : symbols) {
-        if (symbol.name == name) {
-            symbol.scope = newScope;
-            return true;
-        }
+bool SymbolTable::updateScope(int id, Scope newScope) {
+    auto index = findIndex(symbolIndexes, id);
+    if (index == NO_INDEX) {
+        return false;
     }
-    return false;
+    symbols[index].scope = newScope;
+    return true;
 }
 
-bool SymbolTable::symbolExists(const string& name) const {
-    for (auto&& symbol : symbols) {
-        if (symbol.name == name) {
-            return true;
-        }
-    }
-    return false;
+bool SymbolTable::symbolExists(int id) const {
+    return findIndex(symbolIndexes, id) != NO_INDEX;
 }
 
-bool SymbolTable::sectionExists(const string& name) const {
-    for (auto&& section : sections) {
-        if (section.name == name) {
-            return true;
-        }
-    }
-    return false;
+bool SymbolTable::sectionExists(int id) const {
+    return findIndex(sectionIndexes, id) != NO_INDEX;
 }
 
-const SymbolTable::Symbol& SymbolTable::getSymbol(const string& name) const {
-    for (auto&& symbol : symbols) {
-        if (symbol.name == name) {
-            return symbol;
-        }
+const SymbolTable::Symbol& SymbolTable::getSymbol(int id) const {
+    auto index = findIndex(symbolIndexes, id);
+    if (index == NO_INDEX) {
+        throw SymbolNotDefined(interner->getName(id));
     }
-    throw SymbolNotDefined(name);
+    return symbols[index];
 }
 
-const SymbolTable::Section& SymbolTable::getSection(const string& name) const {
-    for (auto&& section : sections) {
-        if (section.name == name) {
-            return section;
-        }
+const SymbolTable::Section& SymbolTable::getSection(int id) const {
+    auto index = findIndex(sectionIndexes, id);
+    if (index == NO_INDEX) {
+        throw SymbolNotDefined(interner->getName(id));
     }
-    throw SymbolNotDefined(name);
+    return sections[index];
 }
 
-void SymbolTable::updateSectionSize(const string& sectionName,
-                                    int sectionSize) {
-    for (auto&& section : sections) {
-        if (section.name == sectionName) {
-            section.size = sectionSize;
-            return;
-        }
+void SymbolTable::updateSectionSize(int sectionId, int sectionSize) {
+    auto index = findIndex(sectionIndexes, sectionId);
+    if (index != NO_INDEX) {
+        sections[index].size = sectionSize;
     }
 }
 
-void SymbolTable::updateRelocationSectionSize(const string& sectionName,
+void SymbolTable::updateRelocationSectionSize(int sectionId,
                                               unsigned int sectionSize) {
-    for (auto&& section : sections) {
-        if (section.name == sectionName) {
-            section.relocationSectionSize = sectionSize;
-            return;
-        }
+    auto index = findIndex(sectionIndexes, sectionId);
+    if (index != NO_INDEX) {
+        sections[index].relocationSectionSize = sectionSize;
     }
 }
 
@@ -0,0 +1,116 @@
+#include "thread_pool.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+using std::function;
+using std::future;
+using std::mutex;
+using std::packaged_task;
+using std::unique_lock;
+
+const int ThreadPool::NO_WORKER = -1;
+
+thread_local const ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local int ThreadPool::currentWorker = ThreadPool::NO_WORKER;
+
+ThreadPool::ThreadPool(int threadCount)
+    : nextQueue(0), pending(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount <= 0) {
+        threadCount = 1;
+    }
+    for (auto i = 0; i < threadCount; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (auto i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        unique_lock<mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (auto&& w : workers) {
+        w.join();
+    }
+}
+
+int ThreadPool::workerIndex() const {
+    return currentPool == this ? currentWorker : NO_WORKER;
+}
+
+bool ThreadPool::onWorker() { return currentPool != nullptr; }
+
+future<void> ThreadPool::submit(function<void()> task) {
+    packaged_task<void()> packagedTask(std::move(task));
+    auto result = packagedTask.get_future();
+    auto index = workerIndex();
+    if (index == NO_WORKER) {
+        index = nextQueue++ % queues.size();
+    }
+    {
+        unique_lock<mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(packagedTask));
+    }
+    {
+        unique_lock<mutex> lock(tasksMutex);
+        pending++;
+    }
+    available.notify_one();
+    return result;
+}
+
+bool ThreadPool::take(int index, packaged_task<void()>& task) {
+    {
+        auto& own = *queues[index];
+        unique_lock<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (auto i = 1u; i < queues.size(); i++) {
+        auto& victim = *queues[(index + i) % queues.size()];
+        unique_lock<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(int index) {
+    currentPool = this;
+    currentWorker = index;
+    while (true) {
+        {
+            unique_lock<mutex> lock(tasksMutex);
+            available.wait(lock, [this] { return stopping || pending > 0; });
+            // Remaining tasks are finished before stopping
+            if (pending == 0) {
+                return;
+            }
+        }
+        packaged_task<void()> task;
+        if (!take(index, task)) {
+            // Counted, but not queued yet or taken by another worker
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            unique_lock<mutex> lock(tasksMutex);
+            pending--;
+        }
+        task();
+    }
+}
@@ -1,13 +1,14 @@
 #include "token.h"
 #include <string>
-#include <vector>
+#include "string_interner.h"
 using std::string;
-using std::vector;
 
-string Token::joinTokens(const vector<Token>& tokens) {
+const int Token::NO_ID = StringInterner::NO_ID;
+
+string Token::joinTokens(const TokenRange& tokens) {
     string sum = "";
     for (auto&& t : tokens) {
         sum += t.getValue();
     }
     return sum;
-}
\ No newline at end of file
+}
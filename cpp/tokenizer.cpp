@@ -1,411 +1,560 @@
 #include "tokenizer.h"
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <future>
+#include <limits>
 #include <string>
 #include <vector>
 #include "exceptions_a.h"
-using std::ifstream;
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "thread_pool.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using std::array;
+using std::deque;
+using std::future;
 using std::string;
 using std::vector;
 
-vector<Token> Tokenizer::parse(ifstream& input) const {
+// Smaller chunks cost more to merge than they gain from running in parallel
+const std::size_t Tokenizer::MIN_CHUNK_SIZE = 0x10000;
+
+// Enough for the workers to stay busy while the consumer merges a chunk
+const int Tokenizer::Pipeline::CHUNKS_PER_WORKER = 2;
+
+bool TokenStream::pull() {
+    if (!source) {
+        return false;
+    }
+    // The block before the current one is no longer referenced, its
+    // storage takes the next block
+    previous.clear();
+    while (previous.empty()) {
+        if (!source->fill(previous)) {
+            source = nullptr;
+            return false;
+        }
+    }
+    tokens.swap(previous);
+    currentIndex = 0;
+    return true;
+}
+
+array<unsigned char, 256> Tokenizer::constructCharacterClasses() {
+    array<unsigned char, 256> classes;
+    classes.fill(IDENTIFICATOR_PART);
+    classes[' '] = classes['\t'] = BLANK;
+    classes['\0'] = classes[';'] = classes['\r'] = classes['\n'] = LINE_END;
+    classes['['] = classes[']'] = classes[','] = classes[':'] = 0;
+    classes['.'] = 0;
+    for (auto c = '0'; c <= '9'; c++) {
+        classes[c] |= DECIMAL_DIGIT | HEX_DIGIT;
+    }
+    for (auto c = 'a'; c <= 'f'; c++) {
+        classes[c] |= HEX_DIGIT;
+        classes[c - 'a' + 'A'] |= HEX_DIGIT;
+    }
+    classes['0'] |= BINARY_DIGIT;
+    classes['1'] |= BINARY_DIGIT;
+    return classes;
+}
+
+const array<unsigned char, 256> Tokenizer::characterClasses =
+    constructCharacterClasses();
+
+#ifdef __SSE2__
+int Tokenizer::matching(const char* current, CharacterClass characterClass) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+    auto equal = [chunk](char c) {
+        return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+    };
+    auto between = [](__m128i bytes, char low, char high) {
+        return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(low - 1)),
+                             _mm_cmplt_epi8(bytes, _mm_set1_epi8(high + 1)));
+    };
+    switch (characterClass) {
+        case BLANK:
+            return _mm_movemask_epi8(_mm_or_si128(equal(' '), equal('\t')));
+        case DECIMAL_DIGIT:
+            return _mm_movemask_epi8(between(chunk, '0', '9'));
+        case HEX_DIGIT: {
+            auto lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+            return _mm_movemask_epi8(_mm_or_si128(between(chunk, '0', '9'),
+                                                  between(lower, 'a', 'f')));
+        }
+        case BINARY_DIGIT:
+            return _mm_movemask_epi8(_mm_or_si128(equal('0'), equal('1')));
+        default: {
+            auto other = _mm_or_si128(
+                _mm_or_si128(_mm_or_si128(equal(' '), equal('\t')),
+                             _mm_or_si128(equal('['), equal(']'))),
+                _mm_or_si128(_mm_or_si128(equal(','), equal(':')),
+                             _mm_or_si128(equal('.'), equal(';'))));
+            other = _mm_or_si128(
+                other, _mm_or_si128(_mm_or_si128(equal('\r'), equal('\n')),
+                                    equal('\0')));
+            return ~_mm_movemask_epi8(other) & 0xFFFF;
+        }
+    }
+}
+#endif
+
+const char* Tokenizer::skip(const char* current, const char* end,
+                            CharacterClass characterClass) {
+#ifdef __SSE2__
+    // Runs are skipped 16 bytes at a time while a whole chunk fits the
+    // buffer, the rest of the run falls through to the table lookup
+    while (end - current >= 16) {
+        auto mismatches = ~matching(current, characterClass) & 0xFFFF;
+        if (mismatches) {
+            return current + __builtin_ctz(mismatches);
+        }
+        current += 16;
+    }
+#endif
+    while (current != end && is(*current, characterClass)) {
+        current++;
+    }
+    return current;
+}
+
+const char* Tokenizer::skipLine(const char* current, const char* end) {
+    auto newLine =
+        static_cast<const char*>(std::memchr(current, '\n', end - current));
+    return newLine ? newLine : end;
+}
+
+long long Tokenizer::convert(const char* begin, const char* end, int base) {
+    const long long max = std::numeric_limits<int>::max();
+    long long value = 0;
+    for (auto current = begin; current != end && value <= max; current++) {
+        auto c = *current | 0x20;
+        value = value * base + (c >= 'a' ? c - 'a' + 10 : c - '0');
+    }
+    return value;
+}
+
+vector<Token> Tokenizer::parse(const SourceBuffer& input) const {
     vector<Token> tokens;
-    try {
-        auto currentLine = 1;
-        for (string line; getline(input, line); currentLine++) {
-            auto t = parse(line, currentLine);
-            tokens.insert(tokens.end(), t.begin(), t.end());
-            tokens.push_back(createNewLineToken());
+    tokens.reserve(input.size() / 4);
+    scan(input.begin(), input.end(), 1, tokens);
+    // Last line isn't terminated by a new line character
+    if (input.size() && input.end()[-1] != '\n') {
+        tokens.push_back(createNewLineToken());
+    }
+    return tokens;
+}
+
+vector<Token> Tokenizer::parse(const SourceBuffer& input,
+                                ThreadPool& pool) const {
+    auto chunks = split(input, pool.size() * 4);
+    if (chunks.size() < 2) {
+        return parse(input);
+    }
+
+    // Line numbers of chunk starts are needed before scanning, for errors
+    vector<future<void>> results;
+    for (auto&& c : chunks) {
+        auto chunk = &c;
+        results.push_back(pool.submit([chunk] {
+            chunk->lineNumber = std::count(chunk->begin, chunk->end, '\n');
+        }));
+    }
+    auto lineNumber = 1;
+    for (auto i = 0u; i < chunks.size(); i++) {
+        results[i].get();
+        auto newLines = chunks[i].lineNumber;
+        chunks[i].lineNumber = lineNumber;
+        lineNumber += newLines;
+    }
+
+    results.clear();
+    for (auto&& c : chunks) {
+        auto chunk = &c;
+        results.push_back(pool.submit([this, chunk] {
+            try {
+                chunk->tokens.reserve((chunk->end - chunk->begin) / 4);
+                Tokenizer(chunk->interner)
+                    .scan(chunk->begin, chunk->end, chunk->lineNumber,
+                          chunk->tokens);
+            } catch (...) {
+                chunk->error = std::current_exception();
+            }
+        }));
+    }
+    for (auto&& r : results) {
+        r.get();
+    }
+
+    // Chunk errors are checked in input order, so the first failing line
+    // is reported no matter which chunk finished first
+    vector<Token> tokens;
+    auto size = 0u;
+    for (auto&& c : chunks) {
+        if (c.error) {
+            std::rethrow_exception(c.error);
         }
-    } catch (const ifstream::failure& f) {
-        throw SystemException("Error while parsing input " + string(f.what()));
+        size += c.tokens.size();
+    }
+    tokens.reserve(size + 1);
+    for (auto&& c : chunks) {
+        merge(c, tokens);
+    }
+    if (input.end()[-1] != '\n') {
+        tokens.push_back(createNewLineToken());
     }
     return tokens;
 }
 
-vector<Token> Tokenizer::parse(const std::string& input, int lineNumber) const {
-    auto feeder = Feeder(input);
-    auto end = false;
-    auto state = HUNTING;
-    string pendingToken = "";
+deque<Tokenizer::Chunk> Tokenizer::split(const SourceBuffer& input,
+                                         int count) {
+    deque<Tokenizer::Chunk> chunks;
+    auto chunkSize = std::max(input.size() / count, MIN_CHUNK_SIZE);
+    auto current = input.begin();
+    while (current != input.end()) {
+        auto chunkEnd = current + std::min<std::size_t>(
+                                      chunkSize, input.end() - current);
+        // Chunks end right after a new line, so no line is split
+        chunkEnd = skipLine(chunkEnd, input.end());
+        if (chunkEnd != input.end()) {
+            chunkEnd++;
+        }
+        chunks.emplace_back(current, chunkEnd);
+        current = chunkEnd;
+    }
+    return chunks;
+}
+
+void Tokenizer::merge(Chunk& chunk, vector<Token>& tokens) const {
+    // Chunk ids are in order of first appearance, so interning them in
+    // that order gives the ids a sequential parse would
+    vector<int> ids;
+    ids.reserve(chunk.interner.size());
+    for (auto i = 0; i < chunk.interner.size(); i++) {
+        ids.push_back(interner.intern(chunk.interner.getName(i)));
+    }
+    for (auto&& t : chunk.tokens) {
+        auto id = t.getId();
+        if (id == Token::NO_ID) {
+            tokens.push_back(t);
+        } else {
+            tokens.push_back(Token(t.getType(), t.getText(), ids[id]));
+        }
+    }
+    vector<Token>().swap(chunk.tokens);
+}
+
+Tokenizer::Pipeline::Pipeline(const Tokenizer& tokenizer,
+                              const SourceBuffer& input, ThreadPool& pool)
+    : tokenizer(tokenizer),
+      input(input),
+      pool(pool),
+      capacity(pool.size() * CHUNKS_PER_WORKER),
+      remaining(input.begin()),
+      lineNumber(1),
+      referenced(input.begin()),
+      released(input.begin()) {
+    submit();
+}
+
+Tokenizer::Pipeline::~Pipeline() {
+    for (auto&& r : results) {
+        r.wait();
+    }
+}
+
+void Tokenizer::Pipeline::submit() {
+    while (chunks.size() < capacity && remaining != input.end()) {
+        // Chunks end right after a new line, so no line is split
+        auto chunkEnd =
+            remaining + std::min<std::size_t>(MIN_CHUNK_SIZE,
+                                              input.end() - remaining);
+        chunkEnd = skipLine(chunkEnd, input.end());
+        if (chunkEnd != input.end()) {
+            chunkEnd++;
+        }
+        chunks.emplace_back(remaining, chunkEnd);
+        auto chunk = &chunks.back();
+        chunk->lineNumber = lineNumber;
+        lineNumber += std::count(remaining, chunkEnd, '\n');
+        remaining = chunkEnd;
+
+        results.push_back(pool.submit([chunk] {
+            try {
+                chunk->tokens.reserve((chunk->end - chunk->begin) / 4);
+                Tokenizer(chunk->interner)
+                    .scan(chunk->begin, chunk->end, chunk->lineNumber,
+                          chunk->tokens);
+            } catch (...) {
+                chunk->error = std::current_exception();
+            }
+        }));
+    }
+}
+
+bool Tokenizer::Pipeline::fill(vector<Token>& tokens) {
+    // After an error the input isn't tokenized any further
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if (chunks.empty()) {
+        return false;
+    }
+    results.front().get();
+    results.pop_front();
+    if (chunks.front().error) {
+        error = chunks.front().error;
+        chunks.pop_front();
+        std::rethrow_exception(error);
+    }
+    // The stream keeps the last merged block as its previous one, the text
+    // of the blocks before is no longer referenced
+    input.release(released, referenced);
+    released = referenced;
+    referenced = chunks.front().begin;
+    tokenizer.merge(chunks.front(), tokens);
+    chunks.pop_front();
+    submit();
+
+    // Last line isn't terminated by a new line character
+    if (chunks.empty() && input.end()[-1] != '\n') {
+        tokens.push_back(tokenizer.createNewLineToken());
+    }
+    return true;
+}
+
+void Tokenizer::Pipeline::finish() {
     vector<Token> tokens;
+    while (fill(tokens)) {
+        tokens.clear();
+    }
+}
 
-    while (!end) {
-        auto character = feeder.feed();
-        switch (state) {
-            case HUNTING:
-                switch (character) {
-                    case ' ':
-                    case '\t':
-                        continue;
-                    case '\0':
-                        end = true;
-                        break;
-                    case '0':
-                        pendingToken += character;
-                        state = ZERO_DETECTED;
-                        break;
-                    case '1':
-                        pendingToken += character;
-                        state = ONE_DETECTED;
-                        break;
-                    case '2':
-                    case '3':
-                    case '4':
-                    case '5':
-                    case '6':
-                    case '7':
-                    case '8':
-                    case '9':
-                        pendingToken += character;
-                        state = DEC_NUMERIC_DETECTION;
-                        break;
-                    case '$':
-                    case '&':
-                    case '[':
-                    case ']':
-                    case ',':
-                    case '*':
-                        tokens.push_back(createCharBasedToken(character));
-                        break;
-                    case '\'':
-                        state = ASCI_DETECTION;
-                        break;
-                    default:
-                        pendingToken += character;
-                        state = IDENTIFICATOR_DETECTION;
-                        break;
-                }
-                break;
-            case IDENTIFICATOR_DETECTION:
-                switch (character) {
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(
-                            createIdentificatorToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case '[':
-                    case ',':
-                        tokens.push_back(
-                            createIdentificatorToken(pendingToken));
-                        tokens.push_back(createCharBasedToken(character));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(
-                            createIdentificatorToken(pendingToken));
-                        tokens.push_back(createCharBasedToken(character));
-                        pendingToken.clear();
-                        state = CLOSED_BRACKETS_DETECTED;
-                        break;
-                    case '\0':
-                        tokens.push_back(
-                            createIdentificatorToken(pendingToken));
-                        end = true;
-                        break;
-                    case ':':
-                        state = LABEL_DETECTION;
-                        break;
-                    case '.':
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                    default:
-                        pendingToken += character;
-                        break;
-                }
-                break;
-            case ZERO_DETECTED:
-                switch (character) {
-                    case ' ':
-                    case '\t':
-                        pendingToken += character;
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case '[':
-                    case ',':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = CLOSED_BRACKETS_DETECTED;
-                        break;
-                    case 'x':
-                    case 'X':
-                        pendingToken += character;
-                        state = HEX_NUMERIC_DETECTION;
-                        break;
-                    case '0':
-                    case '1':
-                        pendingToken += character;
-                        state = BIN_NUMERIC_DETECTION;
-                        break;
-                    case '\0':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        end = true;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
-                break;
-            case ONE_DETECTED:
-                switch (character) {
-                    case '0':
-                    case '1':
-                        pendingToken += character;
-                        break;
-                    case 'b':
-                    case 'B':
-                        pendingToken += character;
-                        state = BIN_NUMERIC_DETECTED;
-                        break;
-                    case '2':
-                    case '3':
-                    case '4':
-                    case '5':
-                    case '6':
-                    case '7':
-                    case '8':
-                    case '9':
-                        pendingToken += character;
-                        state = DEC_NUMERIC_DETECTION;
-                        break;
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        state = HUNTING;
-                        break;
-                    case '[':
-                    case ',':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = CLOSED_BRACKETS_DETECTED;
-                    case '\0':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        end = true;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
-                break;
-            case DEC_NUMERIC_DETECTION:
-                switch (character) {
-                    case '0':
-                    case '1':
-                    case '2':
-                    case '3':
-                    case '4':
-                    case '5':
-                    case '6':
-                    case '7':
-                    case '8':
-                    case '9':
-                        pendingToken += character;
-                        break;
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case ',':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        tokens.push_back(createCharBasedToken(character));
-                        pendingToken.clear();
-                        state = CLOSED_BRACKETS_DETECTED;
-                        break;
-                    case '\0':
-                        tokens.push_back(
-                            createDecimalNumberToken(pendingToken));
-                        end = true;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
-                break;
-            case HEX_NUMERIC_DETECTION:
-                switch (character) {
-                    case '0':
-                    case '1':
-                    case '2':
-                    case '3':
-                    case '4':
-                    case '5':
-                    case '6':
-                    case '7':
-                    case '8':
-                    case '9':
-                    case 'A':
-                    case 'a':
-                    case 'B':
-                    case 'b':
-                    case 'C':
-                    case 'c':
-                    case 'D':
-                    case 'd':
-                    case 'E':
-                    case 'e':
-                    case 'F':
-                    case 'f':
-                        pendingToken += character;
-                        break;
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(createHexNumberToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(createHexNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = CLOSED_BRACKETS_DETECTED;
-                        break;
-                    case '\0':
-                        tokens.push_back(createHexNumberToken(pendingToken));
-                        end = true;
-                        break;
-                    case ',':
-                        tokens.push_back(createHexNumberToken(pendingToken));
-                        pendingToken.clear();
-                        tokens.push_back(createCharBasedToken(character));
-                        state = HUNTING;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
+vector<Token> Tokenizer::parse(const string& input, int lineNumber) const {
+    vector<Token> tokens;
+    scan(input.data(), input.data() + input.size(), lineNumber, tokens);
+    return tokens;
+}
+
+void Tokenizer::scan(const char* current, const char* end, int lineNumber,
+                     vector<Token>& tokens) const {
+    while (current != end) {
+        current = skip(current, end, BLANK);
+        if (current == end) {
+            break;
+        }
+        switch (*current) {
+            case '\n':
+                tokens.push_back(createNewLineToken());
+                lineNumber++;
+                current++;
                 break;
-            case BIN_NUMERIC_DETECTION:
-                switch (character) {
-                    case 'b':
-                    case 'B':
-                        pendingToken += character;
-                        state = BIN_NUMERIC_DETECTED;
-                        break;
-                    case '0':
-                    case '1':
-                        pendingToken += character;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
+            case '\0':
+            case ';':
+            case '\r':
+                current = skipLine(current, end);
                 break;
-            case BIN_NUMERIC_DETECTED:
-                switch (character) {
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(createBinaryNumberToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    case ']':
-                        tokens.push_back(createBinaryNumberToken(pendingToken));
-                        pendingToken.clear();
-                        state = CLOSED_BRACKETS_DETECTED;
-                        break;
-                    case '\0':
-                        tokens.push_back(createBinaryNumberToken(pendingToken));
-                        end = true;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + string(1, character), lineNumber);
-                }
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                current = scanNumber(current, end, lineNumber, tokens);
                 break;
-            case CLOSED_BRACKETS_DETECTED:
-                switch (character) {
-                    case ',':
-                        tokens.push_back(createCharBasedToken(character));
-                    case ' ':
-                    case '\t':
-                        state = HUNTING;
-                        break;
-                    case '\0':
-                        end = true;
-                        break;
-                    default:
-                        throw ParserException(string(1, character), lineNumber);
-                }
+            case '$':
+            case '&':
+            case '[':
+            case ']':
+            case ',':
+            case '*':
+                tokens.push_back(createCharBasedToken(*current));
+                current++;
                 break;
-            case LABEL_DETECTION:
-                switch (character) {
-                    case ';':
-                    case '\0':
-                        tokens.push_back(createLabelToken(pendingToken));
-                        pendingToken.clear();
-                        end = true;
-                        break;
-                    case ' ':
-                    case '\t':
-                        tokens.push_back(createLabelToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    default:
-                        throw ParserException(
-                            pendingToken + ":" + string(1, character),
-                            lineNumber);
-                }
+            case '\'':
+                current = scanAsci(current, end, lineNumber, tokens);
                 break;
-            case ASCI_DETECTION:
-                switch (character) {
-                    case '\'':
-                        tokens.push_back(createAsciToken(pendingToken));
-                        pendingToken.clear();
-                        state = HUNTING;
-                        break;
-                    default:
-                        if (pendingToken.size() == 1) {
-                            throw ParserException(
-                                pendingToken + string(1, character),
-                                lineNumber);
-                        }
-                        pendingToken += character;
-                }
+            case '"':
+                current = scanString(current, end, lineNumber, tokens);
                 break;
             default:
-                throw SystemException("Invalid state detected");
+                current = scanIdentificator(current, end, lineNumber, tokens);
+                break;
         }
     }
+}
 
-    return tokens;
+const char* Tokenizer::scanIdentificator(const char* tokenStart,
+                                         const char* end, int lineNumber,
+                                         vector<Token>& tokens) const {
+    auto current = skip(tokenStart + 1, end, IDENTIFICATOR_PART);
+    auto value = StringRef(tokenStart, current - tokenStart);
+    if (current == end || *current != ':') {
+        if (current != end && *current == '.') {
+            throw ParserException(rejected(tokenStart, current, end),
+                                  lineNumber);
+        }
+        tokens.push_back(createIdentificatorToken(value));
+        return scanSeparator(current, end, tokenStart, true, lineNumber,
+                             tokens);
+    }
+    current++;
+    if (!isLineEnd(current, end) && !is(*current, BLANK)) {
+        throw ParserException(rejected(tokenStart, current, end), lineNumber);
+    }
+    tokens.push_back(createLabelToken(value));
+    return current;
+}
+
+const char* Tokenizer::scanNumber(const char* tokenStart, const char* end,
+                                  int lineNumber, vector<Token>& tokens) const {
+    auto current = tokenStart + 1;
+    auto next = current == end ? '\0' : *current;
+    auto type = Token::DEC_NUMBER;
+    auto base = 10;
+    auto openBracketAllowed = false;
+
+    if (*tokenStart == '0' && (next == 'x' || next == 'X')) {
+        current = skip(current + 1, end, HEX_DIGIT);
+        type = Token::HEX_NUMBER;
+        base = 16;
+    } else if (*tokenStart == '0' && is(next, BINARY_DIGIT)) {
+        // Binary number with leading zeros, must end with the suffix
+        current = skip(current, end, BINARY_DIGIT);
+        if (current == end || (*current != 'b' && *current != 'B')) {
+            throw ParserException(rejected(tokenStart, current, end),
+                                  lineNumber);
+        }
+        type = Token::BIN_NUMBER;
+        base = 2;
+    } else if (*tokenStart == '0') {
+        openBracketAllowed = true;
+    } else if (*tokenStart == '1') {
+        // Ones and zeros are either decimal or binary until the suffix
+        current = skip(current, end, BINARY_DIGIT);
+        if (current != end && (*current == 'b' || *current == 'B')) {
+            type = Token::BIN_NUMBER;
+            base = 2;
+        } else if (current != end && is(*current, DECIMAL_DIGIT)) {
+            current = skip(current, end, DECIMAL_DIGIT);
+        } else {
+            openBracketAllowed = true;
+        }
+    } else {
+        current = skip(current, end, DECIMAL_DIGIT);
+    }
+
+    auto digitsStart = base == 16 ? tokenStart + 2 : tokenStart;
+    auto value = convert(digitsStart, current, base);
+    if (base == 2) {
+        current++;
+    }
+    if (!isLineEnd(current, end) &&
+        !isSeparator(*current, openBracketAllowed)) {
+        throw ParserException(rejected(tokenStart, current, end), lineNumber);
+    }
+    tokens.push_back(createNumberToken(
+        type, StringRef(tokenStart, current - tokenStart), value, lineNumber));
+    return scanSeparator(current, end, tokenStart, openBracketAllowed,
+                         lineNumber, tokens);
+}
+
+const char* Tokenizer::scanAsci(const char* quote, const char* end,
+                                int lineNumber, vector<Token>& tokens) const {
+    auto tokenStart = quote + 1;
+    auto current = tokenStart;
+    // At most one character between the quotes
+    for (auto length = 0; length < 2; length++, current++) {
+        if (isLineEnd(current, end)) {
+            throw ParserException(string(tokenStart, current), lineNumber);
+        }
+        if (*current == '\'') {
+            tokens.push_back(
+                createAsciToken(StringRef(tokenStart, current - tokenStart)));
+            return current + 1;
+        }
+    }
+    throw ParserException(string(tokenStart, current), lineNumber);
+}
+
+// Escaped characters are kept as written, only the closing quote is looked
+// for. A string can't span lines.
+const char* Tokenizer::scanString(const char* quote, const char* end,
+                                  int lineNumber,
+                                  vector<Token>& tokens) const {
+    auto tokenStart = quote + 1;
+    auto current = tokenStart;
+    while (current != end && *current != '\n') {
+        if (*current == '"') {
+            tokens.push_back(createStringToken(
+                StringRef(tokenStart, current - tokenStart)));
+            return scanSeparator(current + 1, end, quote, false, lineNumber,
+                                 tokens);
+        }
+        if (*current == '\\' && current + 1 != end &&
+            current[1] != '\n') {
+            current++;
+        }
+        current++;
+    }
+    throw ParserException(string(quote, current), lineNumber);
+}
+
+// Handles the character following a number or an identificator
+const char* Tokenizer::scanSeparator(const char* current, const char* end,
+                                     const char* tokenStart,
+                                     bool openBracketAllowed, int lineNumber,
+                                     vector<Token>& tokens) const {
+    if (isLineEnd(current, end)) {
+        return current;
+    }
+    if (!isSeparator(*current, openBracketAllowed)) {
+        throw ParserException(rejected(tokenStart, current, end), lineNumber);
+    }
+    switch (*current) {
+        case '[':
+        case ',':
+            tokens.push_back(createCharBasedToken(*current));
+            return current + 1;
+        case ']':
+            tokens.push_back(createCharBasedToken(*current));
+            return scanClosedBrackets(current + 1, end, lineNumber, tokens);
+        default:
+            return current + 1;
+    }
+}
+
+const char* Tokenizer::scanClosedBrackets(const char* current,
+                                          const char* end, int lineNumber,
+                                          vector<Token>& tokens) const {
+    if (isLineEnd(current, end)) {
+        return current;
+    }
+    switch (*current) {
+        case ',':
+            tokens.push_back(createCharBasedToken(*current));
+        case ' ':
+        case '\t':
+            return current + 1;
+    }
+    throw ParserException(string(1, *current), lineNumber);
+}
+
+Token Tokenizer::createNumberToken(Token::Type type, const StringRef& text,
+                                   long long value, int lineNumber) const {
+    if (value > std::numeric_limits<int>::max()) {
+        throw NumberOutOfRangeException(text.str(), lineNumber);
+    }
+    return Token(type, text, value);
 }
 
 Token Tokenizer::createCharBasedToken(char value) const {
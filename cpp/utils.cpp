@@ -3,7 +3,6 @@
 #include <locale>
 #include <string>
 
-using std::ostream;
 using std::string;
 using std::toupper;
 
@@ -14,26 +13,3 @@ string Utils::uppercaseString(const string& str) {
     }
     return result;
 }
-
-int Utils::writeData(ostream& os, unsigned int data, int size,
-                     int currentColumn) {
-    for (unsigned char i = 0; i < size; i++) {
-        unsigned char d = (data >> (i * 8)) & 0xFF;
-        currentColumn = writeByte(os, d, currentColumn);
-    }
-    return currentColumn;
-}
-
-int Utils::writeInstruction(ostream& os, unsigned int data, int size,
-                            int currentColumn) {
-    auto opcodeSize = 2;
-    for (unsigned char i = 0; i < opcodeSize; i++) {
-        unsigned char d = data >> (8 * (3 - i));
-        currentColumn = writeByte(os, d, currentColumn);
-    }
-    for (unsigned char i = 0; i < size - opcodeSize; i++) {
-        unsigned char d = data >> (8 * i);
-        currentColumn = writeByte(os, d, currentColumn);
-    }
-    return currentColumn;
-}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator owning the objects created during one assembly. Objects
+// are never freed one by one, all of them are destroyed together with the
+// arena or by reset, in reverse order of creation.
+class Arena {
+   public:
+    static const std::size_t BLOCK_SIZE;
+
+    Arena() : current(nullptr), remaining(0), usedBlocks(0) {}
+
+    ~Arena() { clear(); }
+
+    Arena(const Arena&) = delete;
+    Arena(Arena&&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena& operator=(Arena&&) = delete;
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        auto memory = allocate(sizeof(T), alignof(T));
+        auto object = new (memory) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            destructors.push_back(Destructor(object, &destroy<T>));
+        }
+        return object;
+    }
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    // Destroys every object, keeping the regular blocks for reuse
+    void reset();
+
+   private:
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+
+        Destructor(void* object, void (*destroy)(void*))
+            : object(object), destroy(destroy) {}
+    };
+
+    template <typename T>
+    static void destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+    void clear();
+
+    // Blocks of BLOCK_SIZE, the first usedBlocks of them hold objects
+    std::vector<std::unique_ptr<char[]>> blocks;
+    // Blocks of a single oversized object each
+    std::vector<std::unique_ptr<char[]>> largeBlocks;
+    std::vector<Destructor> destructors;
+    char* current;
+    std::size_t remaining;
+    std::size_t usedBlocks;
+};
+
+#endif
@@ -1,19 +1,38 @@
 #ifndef ASSEMBLER_H_
 #define ASSEMBLER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
+#include "arena.h"
+#include "header_cache.h"
+#include "isa.h"
 #include "recognizer.h"
 #include "section.h"
+#include "section_cache.h"
+#include "source_buffer.h"
+#include "string_interner.h"
 #include "symbol_table.h"
 #include "tokenizer.h"
 
 class Assembler {
    public:
     static const int MEMORY_SIZE;
+    static const std::size_t PARALLEL_TOKENIZING_SIZE;
+    static const std::size_t PARALLEL_BACKPATCHING_SIZE;
+
+    // Text dump of the object file, or the binary ObjectFile format
+    enum OutputFormat { TEXT, BINARY };
     Assembler() = default;
 
+    // Keeps the encoded sections and the included files of every assembled
+    // file in the directory and reuses the ones that didn't change
+    explicit Assembler(const std::string& cacheDirectory)
+        : cacheDirectory(cacheDirectory), headers(cacheDirectory) {}
+
     Assembler(const Assembler&) = delete;
     Assembler(Assembler&&) = delete;
     Assembler& operator=(const Assembler&) = delete;
@@ -21,12 +40,125 @@ class Assembler {
 
     void assembleFile(const std::string& inputFileName,
                       const std::string& outputFileName,
-                      int startAddress) const;
+                      int startAddress, OutputFormat format = TEXT) const;
+
+    // Assembles into the given arena, reset first so it can be reused
+    // across files
+    void assembleFile(const std::string& inputFileName,
+                      const std::string& outputFileName, int startAddress,
+                      Arena&, OutputFormat format = TEXT) const;
+
+    // Passes of an assembly run on their own, e.g. to time them
+    class Passes;
 
    private:
-    SymbolTable firstPass(TokenStream&, int startAddress) const;
-    std::vector<Section*> secondPass(TokenStream&, int startAddress,
-                                     const SymbolTable& symbolTable) const;
+    // Statement referencing symbols, already encoded into its section.
+    // Backpatching evaluates it with the complete symbol table and encodes
+    // it again at the same offset.
+    struct Fixup {
+        enum Type { INSTRUCTION, DEFINITION };
+
+        Type type;
+        WritableData* statement;
+        Section* section;
+        int location;
+        std::size_t offset;
+
+        Fixup(Type type, WritableData* statement, Section* section,
+              int location, std::size_t offset)
+            : type(type),
+              statement(statement),
+              section(section),
+              location(location),
+              offset(offset) {}
+    };
+
+    // Section tracked by the section cache, with the tokens following the
+    // section directive up to the next section
+    struct CachedSection {
+        Section* section;
+        const Token* begin;
+        const Token* end;
+        int address;
+        std::uint64_t key;
+        // Entry with the same tokens and address, nullptr if there is none
+        const SectionCache::Entry* entry;
+
+        CachedSection(Section* section, const Token* begin, const Token* end,
+                      int address, std::uint64_t key,
+                      const SectionCache::Entry* entry)
+            : section(section),
+              begin(begin),
+              end(end),
+              address(address),
+              key(key),
+              entry(entry) {}
+    };
+
+    std::vector<Token> tokenize(const Tokenizer&, const SourceBuffer&) const;
+
+    // Large inputs are streamed, tokenized ahead of decoding so only a few
+    // chunks of tokens are held at once. The cache needs every token of
+    // the input, so with a cache the input is tokenized up front, as it is
+    // on a batch worker, where a pipeline would start a nested pool.
+    // Included files are expanded in either case.
+    SymbolTable decode(const Tokenizer&, const SourceBuffer&, Includer&,
+                       int startAddress, const StringInterner&, Arena&,
+                       std::vector<Section*>& sections,
+                       std::vector<Fixup>& fixups, SectionCache*,
+                       std::vector<CachedSection>& cachedSections) const;
+
+    // Decodes and encodes every statement once, building the symbol table
+    // and the sections, and collects the statements to backpatch. Every
+    // decoded object is created in the arena.
+    SymbolTable decode(TokenStream&, int startAddress, const StringInterner&,
+                       Arena&, std::vector<Section*>& sections,
+                       std::vector<Fixup>& fixups, SectionCache*,
+                       std::vector<CachedSection>& cachedSections) const;
+    // Definitions, directives and instructions of a section. Returns the
+    // statement size in bytes.
+    int decodeStatement(const Command&, TokenStream&, Section*,
+                        int locationCounter, Arena&,
+                        std::vector<Fixup>& fixups) const;
+
+    // Tracks the section starting at the stream position. If the cache has
+    // an entry for it, defines its labels and skips its tokens.
+    bool reuse(const SectionCache&, TokenStream&, Section*, int address,
+               SymbolTable&, const StringInterner&,
+               std::vector<CachedSection>& cachedSections) const;
+    // Copies cached sections whose dependencies kept their values, and
+    // decodes the others
+    void splice(const std::vector<CachedSection>&, TokenStream&,
+                const SymbolTable&, const StringInterner&, Arena&,
+                std::vector<Fixup>& fixups) const;
+    bool isCurrent(const SectionCache::Entry&, const Section&,
+                   const SymbolTable&, const StringInterner&) const;
+    void store(SectionCache&, const std::vector<CachedSection>&,
+               const SymbolTable&, const StringInterner&) const;
+    // Sections only share the read-only symbol table, so with enough
+    // fixups every section is backpatched on its own thread, unless the
+    // assembly already runs on a worker of a batch
+    void backpatch(const std::vector<Fixup>&,
+                   const SymbolTable& symbolTable) const;
+    // Fixups of a single section
+    void backpatchSection(std::vector<Fixup>::const_iterator begin,
+                          std::vector<Fixup>::const_iterator end,
+                          const SymbolTable& symbolTable) const;
+
+    // Decodes the instruction as a value, only placing it in the arena if
+    // it has to be backpatched
+    template <typename T>
+    int decodeInstruction(const Isa::InstructionSpecification&, TokenStream&,
+                          Section*, int locationCounter, Arena&,
+                          std::vector<Fixup>& fixups) const;
+
+    // Encodes the statement into the section. Only statements referencing
+    // symbols are moved into the arena and kept for backpatching, the
+    // others don't outlive their decoding. Returns the statement size in
+    // bytes.
+    template <typename T>
+    int place(Fixup::Type, T& statement, Section*, int location, Arena&,
+              std::vector<Fixup>& fixups) const;
 
     bool isSequenceValid(const Command& previousCommand,
                          const Command& currenctCommand) const;
@@ -39,6 +171,8 @@ class Assembler {
                 switch (comm.type) {
                     case Command::SKIP_DIR:
                     case Command::ALIGN_DIR:
+                    case Command::STRING_DIR:
+                    case Command::INCBIN_DIR:
                     case Command::DEFINITION:
                     case Command::LABEL:
                     case Command::SECTION:
@@ -62,6 +196,36 @@ class Assembler {
 
     void write(const std::vector<Section*>&, std::ostream&) const;
     Recognizer recognizer;
+    // Empty if sections aren't cached
+    std::string cacheDirectory;
+    // Shared by the assemblies of a batch, so every included file is
+    // tokenized once
+    mutable HeaderCache headers;
+};
+
+// Decoding and backpatching of already tokenized input, without a cache or
+// included files, keeping what one pass leaves for the next
+class Assembler::Passes {
+   public:
+    explicit Passes(const Assembler& assembler) : assembler(assembler) {}
+
+    Passes(const Passes&) = delete;
+    Passes& operator=(const Passes&) = delete;
+
+    // Starts over, the previously decoded sections are released
+    void decode(TokenStream&, int startAddress, const StringInterner&);
+    // Of the last decoded input
+    void backpatch() const;
+
+    const std::vector<Section*>& getSections() const { return sections; }
+
+   private:
+    const Assembler& assembler;
+    Arena arena;
+    std::vector<Section*> sections;
+    std::vector<Fixup> fixups;
+    std::vector<CachedSection> cachedSections;
+    std::unique_ptr<SymbolTable> symbolTable;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "assembler.h"
+
+// Assembly of many files in one process, all sharing one Assembler
+class Batch {
+   public:
+    struct Job {
+        std::string inputFileName;
+        std::string outputFileName;
+        int startAddress;
+
+        Job(const std::string& inputFileName,
+            const std::string& outputFileName, int startAddress = 0)
+            : inputFileName(inputFileName),
+              outputFileName(outputFileName),
+              startAddress(startAddress) {}
+    };
+
+    // One job per line in the format INPUT_FILE OUTPUT_FILE [START_ADDRESS].
+    // Empty lines and lines starting with # are skipped, - reads the list
+    // from stdin.
+    static std::vector<Job> readResponseFile(const std::string& fileName);
+
+    // Assembles every job even if some of them fail, each failure is
+    // reported to the log with the name of its input file, in the order of
+    // the jobs. More than one thread assembles the jobs in parallel, zero
+    // threads means one per hardware thread. Returns the number of failed
+    // jobs.
+    static int run(const Assembler&, const std::vector<Job>&,
+                   Assembler::OutputFormat, std::ostream& log,
+                   int threadCount = 1);
+
+   private:
+    // Empty if the job succeeded
+    static std::string assemble(const Assembler&, const Job&,
+                                Assembler::OutputFormat, Arena&);
+
+    static void readJobs(std::istream&, const std::string& fileName,
+                         std::vector<Job>& jobs);
+};
+
+#endif
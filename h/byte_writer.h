@@ -0,0 +1,59 @@
+#ifndef BYTE_WRITER_H_
+#define BYTE_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Writes encoded bytes of section content into a byte vector, starting at
+// the given position. Bytes past the end of the vector are appended.
+class ByteWriter {
+   public:
+    explicit ByteWriter(std::vector<unsigned char>& bytes)
+        : bytes(bytes), position(bytes.size()) {}
+
+    ByteWriter(std::vector<unsigned char>& bytes, std::size_t position)
+        : bytes(bytes), position(position) {}
+
+    void writeByte(unsigned char d) {
+        if (position < bytes.size()) {
+            bytes[position] = d;
+        } else {
+            bytes.push_back(d);
+        }
+        position++;
+    }
+
+    // Lowest size bytes of the data, least significant first
+    void writeData(unsigned int data, int size);
+
+    // Two opcode bytes from the top of the data, followed by the rest of the
+    // size bytes least significant first
+    void writeInstruction(unsigned int data, int size);
+
+    void writeBytes(const char* begin, const char* end) {
+        auto count = std::size_t(end - begin);
+        auto overwritten = std::min<std::size_t>(
+            count, bytes.size() - std::min(position, bytes.size()));
+        std::copy(begin, begin + overwritten, bytes.begin() + position);
+        bytes.insert(bytes.end(), begin + overwritten, end);
+        position += count;
+    }
+
+    void writeFill(unsigned char d, int count) {
+        if (count <= 0) {
+            return;
+        }
+        auto overwritten = std::min<std::size_t>(
+            count, bytes.size() - std::min(position, bytes.size()));
+        std::fill_n(bytes.begin() + position, overwritten, d);
+        bytes.insert(bytes.end(), count - overwritten, d);
+        position += count;
+    }
+
+   private:
+    std::vector<unsigned char>& bytes;
+    std::size_t position;
+};
+
+#endif
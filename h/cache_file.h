@@ -0,0 +1,50 @@
+#ifndef CACHE_FILE_H_
+#define CACHE_FILE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "exceptions_a.h"
+
+// Binary files the caches keep on disk, values in the byte order of the
+// machine and strings prefixed by their size. The caches only spare work,
+// so a file that can't be read or written is never an error of its own.
+class CacheFile {
+   public:
+    // Whole content of the file, false if it can't be read
+    static bool load(const std::string& fileName, std::string& content);
+
+    // Replaces the file at once through a temporary file of its own, so
+    // concurrent saves and an interrupted one can't leave half a file.
+    // False if the file couldn't be replaced, the previous one stays.
+    static bool save(const std::string& fileName,
+                     const std::vector<char>& content);
+
+    template <typename T>
+    static void append(std::vector<char>& file, const T& value) {
+        auto bytes = reinterpret_cast<const char*>(&value);
+        file.insert(file.end(), bytes, bytes + sizeof(T));
+    }
+
+    static void append(std::vector<char>& file, const std::string& value) {
+        append(file, std::uint32_t(value.size()));
+        file.insert(file.end(), value.begin(), value.end());
+    }
+
+    // Throw SystemException when reading past the end
+    template <typename T>
+    static T read(const char*& current, const char* end) {
+        if (std::uint32_t(end - current) < sizeof(T)) {
+            throw SystemException("Corrupted cache file");
+        }
+        T value;
+        std::memcpy(&value, current, sizeof(T));
+        current += sizeof(T);
+        return value;
+    }
+
+    static std::string readString(const char*& current, const char* end);
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include "string_ref.h"
 
 struct Command {
     enum Type {
@@ -13,14 +14,26 @@ struct Command {
         SECTION,
         ALIGN_DIR,
         SKIP_DIR,
+        STRING_DIR,
+        INCBIN_DIR,
         LABEL,
         EMPTY
     };
 
-    std::string name;
+    static const int NO_KEYWORD = -1;
+    static const int NO_ID = -1;
+
+    // View of the command token, valid as long as the assembled source
+    StringRef name;
     Type type;
+    // Recognizer keyword the command was recognized as
+    int keyword;
+    // Interned name of labels and sections
+    int id;
 
-    Command(const std::string& name, Type type) : name(name), type(type) {}
+    Command(const StringRef& name, Type type, int keyword = NO_KEYWORD,
+            int id = NO_ID)
+        : name(name), type(type), keyword(keyword), id(id) {}
 };
 
 const auto DUMMY_COMMAND = Command("empty", Command::EMPTY);
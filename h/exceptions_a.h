@@ -24,6 +24,21 @@ class ParserException : public AssemblerException {
     int lineNumber;
 };
 
+class NumberOutOfRangeException : public AssemblerException {
+   public:
+    NumberOutOfRangeException(const std::string& token, int lineNumber)
+        : token(token), lineNumber(lineNumber) {}
+
+    std::string error() const override {
+        return "Number " + token + " out of range at line " +
+               Utils::convertToString(lineNumber);
+    }
+
+   private:
+    std::string token;
+    int lineNumber;
+};
+
 class StreamException : public AssemblerException {
    public:
     std::string error() const override { return "End of the stream reached"; }
@@ -137,4 +152,20 @@ class MemoryException : public AssemblerException {
     std::string text;
 };
 
+// Error in a file included by an .include directive, with the file name
+class IncludedFileException : public AssemblerException {
+   public:
+    IncludedFileException(const std::string& fileName,
+                          const AssemblerException& cause)
+        : fileName(fileName), cause(cause.error()) {}
+
+    std::string error() const override {
+        return cause + " in included file " + fileName;
+    }
+
+   private:
+    std::string fileName;
+    std::string cause;
+};
+
 #endif
@@ -0,0 +1,152 @@
+#ifndef HEADER_CACHE_H_
+#define HEADER_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "token.h"
+#include "tokenizer.h"
+
+// Tokens of the files included by .include directives, shared by all the
+// assemblies of a process so every file is tokenized once. A file is found
+// by its real path and its tokens stay valid while its size and
+// modification time don't change. With a directory the tokens are also
+// kept on disk between runs.
+class HeaderCache {
+   public:
+    static const char MAGIC[4];
+    static const std::uint32_t VERSION;
+
+    // Size and modification time of a file when it was tokenized
+    struct Stamp {
+        std::uint64_t size;
+        std::int64_t seconds;
+        std::int64_t nanoseconds;
+
+        friend bool operator==(const Stamp& first, const Stamp& second) {
+            return first.size == second.size &&
+                   first.seconds == second.seconds &&
+                   first.nanoseconds == second.nanoseconds;
+        }
+    };
+
+    // Tokenized file, the ids of its tokens index names. Tokens reference
+    // the text, so a header must be kept as long as its tokens are used.
+    struct Header {
+        Header(const std::string& path, const Stamp& stamp)
+            : path(path), stamp(stamp), text(path) {}
+
+        std::string path;
+        Stamp stamp;
+        SourceBuffer text;
+        std::vector<std::string> names;
+        std::vector<Token> tokens;
+    };
+
+    // Without a directory nothing is kept on disk
+    explicit HeaderCache(const std::string& directory = "")
+        : directory(directory) {}
+
+    HeaderCache(const HeaderCache&) = delete;
+    HeaderCache& operator=(const HeaderCache&) = delete;
+
+    // Header of the file, tokenized again if the file changed since it was
+    // cached. Can be called from several threads, a file is tokenized by
+    // one of them while the others wait for it.
+    std::shared_ptr<const Header> get(const std::string& fileName);
+
+   private:
+    // Header of a file, ready once the thread tokenizing it is done
+    struct Entry {
+        Stamp stamp;
+        std::shared_future<std::shared_ptr<const Header>> header;
+    };
+
+    static std::string realPath(const std::string& fileName);
+    static Stamp stamp(const std::string& path);
+
+    // Text of the tokens the tokenizer doesn't take from the source
+    static const char* fixedText(Token::Type);
+
+    std::string cacheFileName(const std::string& path) const;
+
+    // Header loaded from the directory, or tokenized and saved there
+    std::shared_ptr<const Header> tokenize(const std::string& path,
+                                           const Stamp&) const;
+
+    // Header kept on disk with the stamp, nullptr if there is none
+    std::shared_ptr<Header> load(const std::string& path,
+                                 const Stamp&) const;
+    // A header that can't be saved is tokenized again by the next run
+    void save(const Header&) const;
+
+    std::string directory;
+    std::mutex headersMutex;
+    std::unordered_map<std::string, Entry> headers;
+};
+
+// Replaces the .include lines among the tokens of one assembly with the
+// tokens of the included files, with their ids interned into the interner
+// of the assembly. Included files can include other ones, but not
+// themselves. The used headers are kept as long as the includer.
+class Includer {
+   public:
+    Includer(HeaderCache& cache, StringInterner& interner)
+        : cache(cache), interner(interner) {}
+
+    // Expands the tokens from the given index on, which must start a line.
+    // Tokens without .include lines are left as they are.
+    void expand(std::vector<Token>& tokens, std::size_t from = 0);
+
+    // Expands the blocks of a source as they are filled
+    class Source : public TokenSource {
+       public:
+        Source(Includer& includer, TokenSource& source)
+            : includer(includer), source(source) {}
+
+        bool fill(std::vector<Token>& tokens) override {
+            auto from = tokens.size();
+            if (!source.fill(tokens)) {
+                return false;
+            }
+            includer.expand(tokens, from);
+            return true;
+        }
+
+       private:
+        Includer& includer;
+        TokenSource& source;
+    };
+
+   private:
+    // Start of the .include directive on the line starting at the token,
+    // possibly behind a label, nullptr if the line isn't an .include line
+    static const Token* findInclude(const Token* lineStart, const Token* end);
+
+    // Appends the tokens, replacing their ids with the given ones if there
+    // are any and expanding the .include lines
+    void append(const Token* begin, const Token* end,
+                const std::vector<int>* ids, std::vector<Token>& tokens);
+
+    // Appends the tokens of the file included by the directive, returns the
+    // token after the directive line
+    const Token* include(const Token* directive, const Token* end,
+                         std::vector<Token>& tokens);
+
+    HeaderCache& cache;
+    StringInterner& interner;
+    // Ids in the interner of the names of every used header
+    std::unordered_map<const HeaderCache::Header*, std::vector<int>> ids;
+    std::vector<std::shared_ptr<const HeaderCache::Header>> used;
+    // Real paths of the files being expanded
+    std::vector<std::string> including;
+};
+
+#endif
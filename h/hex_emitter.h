@@ -0,0 +1,55 @@
+#ifndef HEX_EMITTER_H_
+#define HEX_EMITTER_H_
+
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Writes section content as two digit hex bytes, eight to a line, into a
+// buffer that is flushed to the stream in big writes.
+class HexEmitter {
+   public:
+    static const std::size_t BUFFER_SIZE;
+    static const int BYTES_PER_LINE = 8;
+
+    explicit HexEmitter(std::ostream& os);
+
+    ~HexEmitter() { flush(); }
+
+    HexEmitter(const HexEmitter&) = delete;
+    HexEmitter(HexEmitter&&) = delete;
+    HexEmitter& operator=(const HexEmitter&) = delete;
+    HexEmitter& operator=(HexEmitter&&) = delete;
+
+    void writeByte(unsigned char d) {
+        if (BUFFER_SIZE - used < 3) {
+            flush();
+        }
+        buffer[used++] = hexDigits[d][0];
+        buffer[used++] = hexDigits[d][1];
+        column = (column + 1) % BYTES_PER_LINE;
+        buffer[used++] = column ? ' ' : '\n';
+    }
+
+    void writeBytes(const unsigned char* begin, const unsigned char* end);
+
+    // Same as count calls of writeByte, copying whole lines at once
+    void writeFill(unsigned char d, std::size_t count);
+
+    // Terminates the last line if it isn't full
+    void endLine();
+
+    void flush();
+
+   private:
+    static const std::array<std::array<char, 2>, 256> hexDigits;
+    static std::array<std::array<char, 2>, 256> constructHexDigits();
+
+    std::ostream& os;
+    std::vector<char> buffer;
+    std::size_t used;
+    int column;
+};
+
+#endif
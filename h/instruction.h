@@ -1,28 +1,46 @@
 #ifndef INSTRUCTION_H_
 #define INSTRUCTION_H_
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 #include <vector>
+#include "byte_writer.h"
 #include "data.h"
+#include "isa.h"
 #include "operand.h"
+#include "optional.h"
+#include "string_ref.h"
 #include "symbol_table.h"
 #include "tokenizer.h"
 
 class WritableData {
    public:
-    virtual int write(std::ostream&, int currentColumn) const = 0;
+    virtual void write(ByteWriter&) const = 0;
     virtual int getSize() const = 0;
+    // Written content is final only after evaluation with the symbol table
+    virtual bool referencesSymbols() const { return false; }
     virtual ~WritableData() {}
 };
 
 class Instruction : public WritableData {
    public:
+    explicit Instruction(const Isa::InstructionSpecification& specification)
+        : specification(&specification) {}
+
     virtual Instruction& decode(TokenStream&) = 0;
-    virtual RelocationData* evaluate(const SymbolTable&,
-                                     int instructionLocation,
-                                     const std::string& mySection) = 0;
+    virtual Optional<RelocationData> evaluate(const SymbolTable&,
+                                              int instructionLocation,
+                                              int mySection) = 0;
     virtual ~Instruction() {}
+
+   protected:
+    // Mnemonic with its condition suffix, composed only for error messages
+    std::string name() const {
+        return std::string(specification->name) + specification->suffix;
+    }
+
+    const Isa::InstructionSpecification* specification;
 };
 
 class WritableDirective : public WritableData {
@@ -32,7 +50,7 @@ class WritableDirective : public WritableData {
     virtual ~WritableDirective() {}
 };
 
-class Definition : public WritableDirective {
+class Definition final : public WritableDirective {
    public:
     Definition(const std::string& name, int multiplier)
         : name(name), multiplier(multiplier) {}
@@ -41,11 +59,20 @@ class Definition : public WritableDirective {
 
     std::vector<RelocationData> evaluate(const SymbolTable&,
                                          int locationCounter,
-                                         const std::string& section);
+                                         int section);
 
     bool initialized() const override { return datas.size() != 0; }
 
-    int write(std::ostream&, int address) const override;
+    bool referencesSymbols() const override {
+        for (auto&& data : datas) {
+            if (data.referencesSymbol()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void write(ByteWriter&) const override;
 
     int getSize() const override {
         return (datas.size() == 0 ? multiplier : multiplier * datas.size()) * 8;
@@ -65,10 +92,12 @@ class SkipDirective : public WritableDirective {
 
     bool initialized() const override { return fill != 0; }
 
-    int write(std::ostream&, int currentColumn) const override;
+    void write(ByteWriter&) const override;
 
     int getSize() const override { return size * 8; }
 
+    unsigned char getFill() const { return fill; }
+
    private:
     int size;
     char fill;
@@ -87,10 +116,12 @@ class AlignDirective : public WritableDirective {
 
     AlignDirective& evaluate(int currentLocationCounter);
 
-    int write(std::ostream&, int currentColumn) const override;
+    void write(ByteWriter&) const override;
 
     int getSize() const override { return size * 8; }
 
+    unsigned char getFill() const { return fill; }
+
    private:
     int padd;
     int fill;
@@ -98,181 +129,151 @@ class AlignDirective : public WritableDirective {
     int size;
 };
 
-class SingleAddressInstruction : public Instruction {
+// Bytes of the string literals of an .ascii or .asciz directive, with the
+// escape sequences replaced. Every string of .asciz is terminated by zero.
+class StringDirective : public WritableDirective {
    public:
-    SingleAddressInstruction(const std::string& name, unsigned char opcode,
-                             bool dstExists)
-        : name(name), opcode(opcode), dstExists(dstExists), operand(nullptr) {}
-
-    ~SingleAddressInstruction() { free(); }
+    explicit StringDirective(bool terminated)
+        : terminated(terminated), size(0) {}
 
-    SingleAddressInstruction(const SingleAddressInstruction& sai) { copy(sai); }
+    StringDirective& decode(TokenStream&) override;
 
-    SingleAddressInstruction(SingleAddressInstruction&& sai) { move(sai); }
+    bool initialized() const override { return true; }
 
-    SingleAddressInstruction& operator=(const SingleAddressInstruction& sai) {
-        if (&sai != this) {
-            free();
-            copy(sai);
-        }
-        return *this;
-    }
-
-    SingleAddressInstruction& operator=(SingleAddressInstruction&& sai) {
-        if (&sai != this) {
-            free();
-            move(sai);
-        }
-        return *this;
-    }
+    void write(ByteWriter&) const override;
 
-    Instruction& decode(TokenStream&) override;
-    RelocationData* evaluate(const SymbolTable& symbolTable,
-                             int instructionLocation,
-                             const std::string& mySection) override {
-        return operand->evaluate(symbolTable, instructionLocation + 2,
-                                 instructionLocation + 4, mySection);
-    }
-    int getSize() const override { return 11 + operand->getSize(); }
+    int getSize() const override { return size * 8; }
 
-    int write(std::ostream&, int currentColumn) const override;
+    // Characters of a string literal with the escape sequences replaced
+    static std::string unescape(const StringRef& text);
 
    private:
-    void copy(const SingleAddressInstruction& sai) {
-        operand = new Operand(*sai.operand);
-        name = sai.name;
-        opcode = sai.opcode;
-        dstExists = sai.dstExists;
-    }
-
-    void move(SingleAddressInstruction& sai) {
-        operand = sai.operand;
-        name = sai.name;
-        opcode = sai.opcode;
-        dstExists = sai.dstExists;
-        sai.operand = nullptr;
-    }
-
-    void free() {
-        delete operand;
-        operand = nullptr;
-    }
+    // Value of the escape sequence after a backslash, moving current past
+    // the sequence
+    static unsigned char unescape(const char*& current, const char* end);
 
-    Operand* operand;
-    std::string name;
-    unsigned char opcode;
-    bool dstExists;
+    std::vector<StringRef> strings;
+    bool terminated;
+    int size;
 };
 
-class DoubleAddressInstruction : public Instruction {
+// Bytes of a file included by an .incbin directive, starting at an offset
+// and up to a length. Only the range is decoded, the bytes are never copied
+// into the section.
+class IncbinDirective {
    public:
-    DoubleAddressInstruction(const std::string& name, unsigned char opcode)
-        : name(name), opcode(opcode), dst(nullptr), src(nullptr) {}
+    IncbinDirective() : offset(0), length(0), lengthGiven(false) {}
 
-    ~DoubleAddressInstruction() { free(); }
+    IncbinDirective& decode(TokenStream&);
 
-    DoubleAddressInstruction(const DoubleAddressInstruction& dai) { copy(dai); }
+    // Checks the range against the size of the file, without a length the
+    // range extends to the end of it
+    IncbinDirective& evaluate(std::size_t fileSize);
 
-    DoubleAddressInstruction(DoubleAddressInstruction&& dai) { move(dai); }
+    const std::string& getFileName() const { return fileName; }
 
-    DoubleAddressInstruction& operator=(const DoubleAddressInstruction& dai) {
-        if (&dai != this) {
-            free();
-            copy(dai);
-        }
-        return *this;
-    }
+    std::size_t getOffset() const { return offset; }
 
-    DoubleAddressInstruction& operator=(DoubleAddressInstruction&& dai) {
-        if (&dai != this) {
-            free();
-            move(dai);
-        }
-        return *this;
-    }
+    std::size_t getLength() const { return length; }
+
+   private:
+    std::string fileName;
+    std::size_t offset;
+    std::size_t length;
+    bool lengthGiven;
+};
+
+class SingleAddressInstruction final : public Instruction {
+   public:
+    explicit SingleAddressInstruction(
+        const Isa::InstructionSpecification& specification)
+        : Instruction(specification) {}
 
     Instruction& decode(TokenStream&) override;
-    RelocationData* evaluate(const SymbolTable& symbolTable,
-                             int instructionLocation,
-                             const std::string& mySection) override {
-        return dst->getSize() > src->getSize()
-                   ? dst->evaluate(symbolTable, instructionLocation + 2,
-                                   instructionLocation + 4, mySection)
-                   : src->evaluate(symbolTable, instructionLocation + 2,
-                                   instructionLocation + 4, mySection);
+    Optional<RelocationData> evaluate(const SymbolTable& symbolTable,
+                                      int instructionLocation,
+                                      int mySection) override {
+        return operand.evaluate(symbolTable, instructionLocation + 2,
+                                instructionLocation + 4, mySection);
     }
-    int getSize() const override { return 6 + dst->getSize() + src->getSize(); }
+    int getSize() const override { return 11 + operand.getSize(); }
 
-    int write(std::ostream&, int currentColumn) const override;
+    bool referencesSymbols() const override {
+        return operand.referencesSymbol();
+    }
+
+    void write(ByteWriter&) const override;
 
    private:
-    void copy(const DoubleAddressInstruction& dai) {
-        dst = new Operand(*dai.dst);
-        src = new Operand(*dai.src);
-        opcode = dai.opcode;
-        name = dai.name;
-    }
+    Operand operand;
+};
+
+class DoubleAddressInstruction final : public Instruction {
+   public:
+    explicit DoubleAddressInstruction(
+        const Isa::InstructionSpecification& specification)
+        : Instruction(specification) {}
 
-    void move(DoubleAddressInstruction& dai) {
-        dst = dai.dst;
-        src = dai.src;
-        opcode = dai.opcode;
-        name = dai.name;
-        dai.dst = nullptr;
-        dai.src = nullptr;
+    Instruction& decode(TokenStream&) override;
+    Optional<RelocationData> evaluate(const SymbolTable& symbolTable,
+                                      int instructionLocation,
+                                      int mySection) override {
+        return dst.getSize() > src.getSize()
+                   ? dst.evaluate(symbolTable, instructionLocation + 2,
+                                  instructionLocation + 4, mySection)
+                   : src.evaluate(symbolTable, instructionLocation + 2,
+                                  instructionLocation + 4, mySection);
     }
+    int getSize() const override { return 6 + dst.getSize() + src.getSize(); }
 
-    void free() {
-        delete src;
-        src = nullptr;
-        delete dst;
-        dst = nullptr;
+    bool referencesSymbols() const override {
+        return dst.referencesSymbol() || src.referencesSymbol();
     }
 
-    std::string name;
-    Operand* dst;
-    Operand* src;
-    unsigned char opcode;
+    void write(ByteWriter&) const override;
+
+   private:
+    Operand dst;
+    Operand src;
 };
 
-class NoAddressInstruction : public Instruction {
+class NoAddressInstruction final : public Instruction {
    public:
-    NoAddressInstruction(const std::string& name, unsigned char opcode)
-        : name(name), opcode(opcode) {}
+    explicit NoAddressInstruction(
+        const Isa::InstructionSpecification& specification)
+        : Instruction(specification) {}
 
     Instruction& decode(TokenStream& tokenStream) override {
         if (tokenStream.end()) {
             throw DecodingException("Invalid end of file at instruction " +
-                                    name);
+                                    name());
         }
         auto t = tokenStream.next();
         if (t.getType() != Token::LINE_DELIMITER) {
-            throw DecodingException("Invalid token after instruction " + name +
-                                    " " + t.getTypeDescription());
+            throw DecodingException("Invalid token after instruction " +
+                                    name() + " " + t.getTypeDescription());
         }
         return *this;
     }
 
-    RelocationData* evaluate(const SymbolTable&, int instructionLocation,
-                             const std::string& mySection) override {
-        return nullptr;
+    Optional<RelocationData> evaluate(const SymbolTable&,
+                                      int instructionLocation,
+                                      int mySection) override {
+        return Optional<RelocationData>();
     }
 
     int getSize() const override { return 16; }
 
-    int write(std::ostream& os, int currentColumn) const override {
-        return Utils::writeInstruction(os, opcode << 26, 2, currentColumn);
+    void write(ByteWriter& writer) const override {
+        writer.writeInstruction(specification->opcode << 26, 2);
     }
-
-   private:
-    std::string name;
-    unsigned char opcode;
 };
 
-class RetInstruction : public Instruction {
+
+class RetInstruction final : public Instruction {
    public:
-    RetInstruction(const std::string& name, unsigned char opcode)
-        : name(name), opcode(opcode) {}
+    explicit RetInstruction(const Isa::InstructionSpecification& specification)
+        : Instruction(specification) {}
 
     Instruction& decode(TokenStream& tokenStream) override {
         if (tokenStream.next().getType() != Token::LINE_DELIMITER) {
@@ -281,88 +282,44 @@ class RetInstruction : public Instruction {
         return *this;
     }
 
-    RelocationData* evaluate(const SymbolTable&, int instructionLocation,
-                             const std::string& mySection) override {
-        return nullptr;
+    Optional<RelocationData> evaluate(const SymbolTable&,
+                                      int instructionLocation,
+                                      int mySection) override {
+        return Optional<RelocationData>();
     }
 
-    int write(std::ostream& os, int currentColumn) const override {
-        return Utils::writeInstruction(os, opcode << 26 | 0xF << 21, 2,
-                                       currentColumn);
+    void write(ByteWriter& writer) const override {
+        writer.writeInstruction(specification->opcode << 26 | 0xF << 21, 2);
     }
 
     int getSize() const override { return 16; }
-
-   private:
-    std::string name;
-    unsigned char opcode;
 };
 
-class JmpInstruction : public Instruction {
+class JmpInstruction final : public Instruction {
    public:
-    JmpInstruction(const std::string& name, unsigned char prefix)
-        : name(name), prefix(prefix), opcode(0) {}
-
-    ~JmpInstruction() { delete operand; }
-
-    JmpInstruction(const JmpInstruction& jmpi) { copy(jmpi); }
-
-    JmpInstruction(JmpInstruction&& jmpi) { move(jmpi); }
-
-    JmpInstruction& operator=(const JmpInstruction& jmpi) {
-        if (&jmpi != this) {
-            free();
-            copy(jmpi);
-        }
-        return *this;
-    }
-
-    JmpInstruction& operator=(JmpInstruction&& jmpi) {
-        if (&jmpi != this) {
-            free();
-            move(jmpi);
-        }
-        return *this;
-    }
+    explicit JmpInstruction(const Isa::InstructionSpecification& specification)
+        : Instruction(specification), opcode(0) {}
 
     Instruction& decode(TokenStream&) override;
 
-    RelocationData* evaluate(const SymbolTable& symbolTable,
-                             int instructionLocation,
-                             const std::string& mySection) override {
-        return operand->evaluate(symbolTable, instructionLocation + 2,
-                                 instructionLocation + 4, mySection);
+    Optional<RelocationData> evaluate(const SymbolTable& symbolTable,
+                                      int instructionLocation,
+                                      int mySection) override {
+        return operand.evaluate(symbolTable, instructionLocation + 2,
+                                instructionLocation + 4, mySection);
     }
 
-    int write(std::ostream&, int currentColumn) const override;
-
-    int getSize() const override { return operand->getSize() + 11; }
+    void write(ByteWriter&) const override;
 
-   private:
-    void copy(const JmpInstruction& jmpi) {
-        operand = new Operand(*jmpi.operand);
-        name = jmpi.name;
-        opcode = jmpi.opcode;
-        prefix = jmpi.prefix;
-    }
+    int getSize() const override { return operand.getSize() + 11; }
 
-    void move(JmpInstruction& jmpi) {
-        operand = jmpi.operand;
-        name = jmpi.name;
-        opcode = jmpi.opcode;
-        prefix = jmpi.prefix;
-        jmpi.operand = nullptr;
+    bool referencesSymbols() const override {
+        return operand.referencesSymbol();
     }
 
-    void free() {
-        delete operand;
-        operand = nullptr;
-    }
-
-    std::string name;
-    unsigned char prefix;
+   private:
     unsigned char opcode;
-    Operand* operand;
+    Operand operand;
 };
 
 #endif
\ No newline at end of file
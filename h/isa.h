@@ -0,0 +1,107 @@
+#ifndef ISA_H_
+#define ISA_H_
+
+// Instruction set, described once. Every mnemonic takes the eq, ne, gt and
+// al condition suffixes, no suffix means al. The expanded table of all
+// instructions is generated at compile time.
+class Isa {
+   public:
+    enum Family { SINGLE_ADDRESS, DOUBLE_ADDRESS, NO_ADDRESS, RET, JMP };
+
+    struct Mnemonic {
+        const char* name;
+        Family family;
+        unsigned char opcode;
+        bool dst;
+    };
+
+    struct Condition {
+        const char* suffix;
+        unsigned char code;
+    };
+
+    // Mnemonic with one of the condition suffixes
+    struct InstructionSpecification {
+        const char* name;
+        const char* suffix;
+        Family family;
+        unsigned char opcode;
+        bool dst;
+    };
+
+    static constexpr Mnemonic MNEMONICS[] = {
+        {"add", DOUBLE_ADDRESS, 0x0, true},
+        {"sub", DOUBLE_ADDRESS, 0x1, true},
+        {"mul", DOUBLE_ADDRESS, 0x2, true},
+        {"div", DOUBLE_ADDRESS, 0x3, true},
+        {"cmp", DOUBLE_ADDRESS, 0x4, true},
+        {"and", DOUBLE_ADDRESS, 0x5, true},
+        {"or", DOUBLE_ADDRESS, 0x6, true},
+        {"not", DOUBLE_ADDRESS, 0x7, true},
+        {"test", DOUBLE_ADDRESS, 0x8, true},
+        {"push", SINGLE_ADDRESS, 0x9, false},
+        {"pop", SINGLE_ADDRESS, 0xA, true},
+        {"call", SINGLE_ADDRESS, 0xB, false},
+        {"iret", NO_ADDRESS, 0xC, true},
+        {"mov", DOUBLE_ADDRESS, 0xD, true},
+        {"shl", DOUBLE_ADDRESS, 0xE, true},
+        {"shr", DOUBLE_ADDRESS, 0xF, true},
+        {"ret", RET, 0xA, true},
+        {"jmp", JMP, 0x0, true}};
+
+    static constexpr Condition CONDITIONS[] = {
+        {"", 0x3}, {"eq", 0x0}, {"ne", 0x1}, {"gt", 0x2}, {"al", 0x3}};
+
+    static constexpr int MNEMONIC_COUNT =
+        sizeof(MNEMONICS) / sizeof(MNEMONICS[0]);
+    static constexpr int CONDITION_COUNT =
+        sizeof(CONDITIONS) / sizeof(CONDITIONS[0]);
+    static constexpr int INSTRUCTION_COUNT = MNEMONIC_COUNT * CONDITION_COUNT;
+
+    static constexpr InstructionSpecification expand(int index) {
+        return expand(MNEMONICS[index / CONDITION_COUNT],
+                      CONDITIONS[index % CONDITION_COUNT]);
+    }
+
+    static constexpr InstructionSpecification expand(const Mnemonic& m,
+                                                     const Condition& c) {
+        return {m.name, c.suffix, m.family, encode(m, c), m.dst};
+    }
+
+    // Condition is the upper part of the opcode, jumps carry it alone as
+    // the opcode prefix
+    static constexpr unsigned char encode(const Mnemonic& m,
+                                          const Condition& c) {
+        return m.family == JMP ? c.code : c.code << 4 | m.opcode;
+    }
+};
+
+template <int... Indexes>
+struct IndexSequence {};
+
+template <int N, int... Indexes>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Indexes...> {};
+
+template <int... Indexes>
+struct MakeIndexSequence<0, Indexes...> {
+    typedef IndexSequence<Indexes...> type;
+};
+
+template <typename>
+struct InstructionTable;
+
+template <int... Indexes>
+struct InstructionTable<IndexSequence<Indexes...>> {
+    static constexpr Isa::InstructionSpecification SPECIFICATIONS[] = {
+        Isa::expand(Indexes)...};
+};
+
+template <int... Indexes>
+constexpr Isa::InstructionSpecification
+    InstructionTable<IndexSequence<Indexes...>>::SPECIFICATIONS[];
+
+// All instructions, a mnemonic followed by its conditional variants
+typedef InstructionTable<MakeIndexSequence<Isa::INSTRUCTION_COUNT>::type>
+    Instructions;
+
+#endif
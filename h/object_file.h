@@ -0,0 +1,99 @@
+#ifndef OBJECT_FILE_H_
+#define OBJECT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "section.h"
+#include "symbol_table.h"
+
+// Binary object file. All records have fixed size and 4 byte alignment and
+// are stored in host byte order, so a mapped file can be used in place:
+//
+//   Header
+//   SectionHeader[sectionCount]
+//   SymbolRecord[symbolCount]
+//   RelocationRecord[...]     relocations of all sections, section by section
+//   string table              zero terminated names
+//   section contents          raw bytes, each starting at a 4 byte boundary
+//
+// Offsets are from the beginning of the file.
+class ObjectFile {
+   public:
+    static const char MAGIC[4];
+    static const std::uint32_t VERSION;
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t sectionCount;
+        std::uint32_t sectionOffset;
+        std::uint32_t symbolCount;
+        std::uint32_t symbolOffset;
+        std::uint32_t relocationCount;
+        std::uint32_t relocationOffset;
+        std::uint32_t stringTableSize;
+        std::uint32_t stringTableOffset;
+    };
+
+    struct SectionHeader {
+        std::uint32_t name;
+        std::uint32_t type;
+        std::uint32_t number;
+        std::uint32_t address;
+        std::uint32_t size;
+        std::uint32_t contentOffset;
+        std::uint32_t contentSize;
+        std::uint32_t firstRelocation;
+        std::uint32_t relocationCount;
+    };
+
+    struct SymbolRecord {
+        std::uint32_t name;
+        std::int32_t section;
+        std::int32_t address;
+        std::uint32_t number;
+        std::uint32_t scope;
+    };
+
+    // Info holds the value shifted left by one and the relocation type in
+    // the lowest bit
+    struct RelocationRecord {
+        std::uint32_t offset;
+        std::uint32_t info;
+    };
+
+    static void write(std::ostream&, const SymbolTable&,
+                      const std::vector<Section*>&);
+
+    // Writes the text format of the object file held in the given range
+    static void dump(const char* begin, const char* end, std::ostream&);
+
+    static void dumpFile(const std::string& inputFileName,
+                         const std::string& outputFileName);
+
+   private:
+    // Bytes of a fill written at once
+    static const std::size_t FILL_BLOCK_SIZE = 0x1000;
+
+    static std::uint32_t align(std::uint32_t offset) {
+        return (offset + 3) & ~3u;
+    }
+
+    template <typename T>
+    static void append(std::vector<char>& file, const T& record);
+
+    static void writeFill(std::ostream&, unsigned char byte,
+                          std::size_t length);
+
+    template <typename T>
+    static const T* records(const char* begin, const char* end,
+                            std::uint32_t offset, std::uint32_t count);
+
+    static std::string name(const char* begin, const Header&,
+                            std::uint32_t offset);
+};
+
+#endif
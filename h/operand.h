@@ -1,9 +1,9 @@
 #ifndef OPERAND_H
 #define OPERAND_H
 
-#include <string>
-#include <vector>
 #include "data.h"
+#include "optional.h"
+#include "string_ref.h"
 #include "symbol_table.h"
 #include "token.h"
 
@@ -18,15 +18,26 @@ enum AddressMode {
     PC_RELATIVE
 };
 
+// Small value type, symbol references are kept as interned ids
 class Operand {
    public:
-    // Operand() : constantDataRaw(UNDEFINED_TOKEN), constantData(0) {}
+    // Set of address modes, one bit per mode
+    static constexpr unsigned int modeSet() { return 0; }
 
-    Operand(const std::vector<Token>&,
-            const std::vector<AddressMode>& invalidAddressModes = {});
+    template <typename... Modes>
+    static constexpr unsigned int modeSet(AddressMode mode, Modes... modes) {
+        return 1u << mode | modeSet(modes...);
+    }
+
+    Operand()
+        : addressMode(IMMEDIATE_CONSTANT),
+          registryData(0),
+          constantData(0),
+          symbolId(Token::NO_ID) {}
+
+    Operand(const TokenRange&, unsigned int invalidAddressModes = 0);
 
-    Operand(const Token& token,
-            const std::vector<AddressMode>& invalidAddressModes = {});
+    Operand(const Token& token, unsigned int invalidAddressModes = 0);
 
     AddressMode getAddressMode() const { return addressMode; }
 
@@ -74,31 +85,29 @@ class Operand {
 
     int getFullConstantData() const { return constantData; }
 
-    RelocationData* evaluate(const SymbolTable&, int myLocation,
-                             int nextInstructionLocation,
-                             const std::string& mySection);
+    // Whether evaluate needs the symbol table
+    bool referencesSymbol() const { return symbolId != Token::NO_ID; }
+
+    Optional<RelocationData> evaluate(const SymbolTable&, int myLocation,
+                                      int nextInstructionLocation,
+                                      int mySection);
 
    private:
     struct Registry {
-        std::string name;
+        const char* name;
         unsigned char code;
-
-        Registry(const std::string& name, unsigned char code)
-            : name(name), code(code) {}
     };
 
-    static const std::vector<Registry> registries;
-    static std::vector<Registry> constructRegistries();
-    static int getRegistry(const std::string&);
-
-    bool isIllegalAddressMode(const std::vector<AddressMode>&) const;
+    static const Registry registries[];
+    static int getRegistry(const StringRef&);
 
-    void determineOperand(const std::vector<Token>&);
+    void determineOperand(const TokenRange&);
 
     AddressMode addressMode;
-    int registryData;
+    unsigned char registryData;
     int constantData;
-    Token constantDataRaw;
+    // Interned name of the referenced symbol, NO_ID if there is none
+    int symbolId;
 };
 
 #endif
\ No newline at end of file
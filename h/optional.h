@@ -0,0 +1,34 @@
+#ifndef OPTIONAL_H_
+#define OPTIONAL_H_
+
+#include <new>
+#include <type_traits>
+
+// Value that may be missing, stored inline. Limited to trivially copyable
+// types, which is all the assembler needs it for.
+template <typename T>
+class Optional {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Optional only holds trivially copyable values");
+
+   public:
+    Optional() : present(false) {}
+
+    Optional(const T& value) : present(true) { new (&storage) T(value); }
+
+    explicit operator bool() const { return present; }
+
+    bool hasValue() const { return present; }
+
+    const T& operator*() const { return *reinterpret_cast<const T*>(&storage); }
+
+    const T* operator->() const {
+        return reinterpret_cast<const T*>(&storage);
+    }
+
+   private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    bool present;
+};
+
+#endif
@@ -1,65 +1,84 @@
 #ifndef RECOGNIZER_H_
 #define RECOGNIZER_H_
 
+#include <array>
+#include <cstddef>
 #include <string>
 #include <vector>
+#include "arena.h"
 #include "data.h"
 #include "instruction.h"
+#include "isa.h"
 #include "section.h"
+#include "string_ref.h"
 #include "tokenizer.h"
 
 class Recognizer {
    public:
-    Recognizer();
     Command recognizeCommand(TokenStream&) const;
+    // Section and instructions are created in the arena
     Section* recognizeSection(const Command& comm, TokenStream&,
-                              unsigned int address) const;
-    std::vector<std::string> recognizeGlobalSymbols(TokenStream&) const;
+                              unsigned int address, Arena&) const;
+    // Interned names of the declared symbols
+    std::vector<int> recognizeGlobalSymbols(TokenStream&) const;
     Definition recognizeDefinition(const Command&) const;
-    Instruction* recognizeInstruction(const Command&) const;
+    StringDirective recognizeString(const Command&) const;
+    const Isa::InstructionSpecification& recognizeInstruction(
+        const Command&) const;
+
+    // Start of the first line in the range holding a section or an end
+    // directive, possibly behind a label. The end of the range if there
+    // is none.
+    const Token* findSectionEnd(const Token* begin, const Token* end) const;
 
    private:
     struct SectionSpecification {
-        std::string name;
+        const char* name;
         Section::Type type;
+    };
 
-        SectionSpecification(const std::string& name, Section::Type type)
-            : name(name), type(type) {}
+    struct DefinitionSpecification {
+        const char* name;
+        int size;
     };
 
-    struct InstructionSpecification {
-        std::string name;
-        unsigned char opcode;
-        bool dst;
+    struct StringSpecification {
+        const char* name;
+        bool terminated;
+    };
 
-        InstructionSpecification(const std::string& name, unsigned char opcode,
-                                 bool dst = true)
-            : name(name), opcode(opcode), dst(dst) {}
+    // Directive, section, definition or instruction name split in two
+    // parts, the mnemonic and the condition suffix for instructions, and
+    // the index of its specification
+    struct Keyword {
+        const char* name;
+        const char* suffix;
+        Command::Type type;
+        int spec;
     };
 
-    struct DefinitionSpecification {
-        std::string name;
-        int size;
+    static const int KEYWORD_SLOTS = 256;
 
-        DefinitionSpecification(const std::string name, int size)
-            : name(name), size(size) {}
-    };
+    static const SectionSpecification sectionSpecifications[];
+    static const DefinitionSpecification definitionSpecifications[];
+    static const StringSpecification stringSpecifications[];
+
+    // Open addressing table, empty slots have no name
+    static const std::array<Keyword, KEYWORD_SLOTS> keywords;
+    static std::array<Keyword, KEYWORD_SLOTS> constructKeywords();
+    static void addKeyword(std::array<Keyword, KEYWORD_SLOTS>&,
+                           const Keyword&);
+
+    // Slot of the keyword written in lower or upper case, NO_KEYWORD if
+    // there is none
+    static int findKeyword(const StringRef&);
 
-    bool isGlobalDirective(const Token&) const;
-    bool isEndDirective(const Token&) const;
-    bool isAlignDirective(const Token&) const;
-    bool isSkipDirective(const Token&) const;
-    bool isSection(const Token&) const;
-    bool isDefinition(const Token&) const;
-    bool isInstruction(const Token&) const;
+    static const Keyword& getKeyword(const Command&, Command::Type);
 
-    std::vector<SectionSpecification> sectionSpecifications;
-    std::vector<InstructionSpecification> singleAddressInstructionSpecs;
-    std::vector<InstructionSpecification> doubleAddressInstructionSpecs;
-    std::vector<InstructionSpecification> noAddressInstructionSpecs;
-    std::vector<InstructionSpecification> retInstructionSpecs;
-    std::vector<InstructionSpecification> jmpInstructionSpecs;
-    std::vector<DefinitionSpecification> definitionSpecifications;
+    static std::size_t hashKeyword(const char* name, const char* suffix);
+    static std::size_t hashKeyword(const StringRef&,
+                                   std::size_t hash = 2166136261u);
+    static bool matchesKeyword(const StringRef&, const Keyword&);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,35 +1,87 @@
 #ifndef SECTION_H_
 #define SECTION_H_
 
+#include <cstddef>
 #include <ostream>
 #include <string>
 #include <vector>
+#include "byte_writer.h"
 #include "data.h"
 #include "exceptions_a.h"
 #include "instruction.h"
 
+// Content is kept as the encoded bytes of the statements, with the long
+// fills of .skip and .align directives and the files included by .incbin
+// between them stored as runs.
 class Section {
    public:
     enum Type { RODATA, DATA, TEXT, BSS };
 
-    Section(const std::string& name, Type type, unsigned int address)
-        : name(name), type(type), address(address) {}
+    // Shorter fills are stored as encoded bytes
+    static const std::size_t MIN_FILL_LENGTH;
 
-    ~Section();
+    // Run at an offset of the whole content, either of one repeated byte or
+    // of bytes owned elsewhere
+    struct Run {
+        std::size_t offset;
+        std::size_t length;
+        unsigned char byte;
+        // Nullptr for a fill
+        const unsigned char* data;
+
+        Run(std::size_t offset, std::size_t length, unsigned char byte)
+            : offset(offset), length(length), byte(byte), data(nullptr) {}
+
+        Run(std::size_t offset, std::size_t length, const unsigned char* data)
+            : offset(offset), length(length), byte(0), data(data) {}
+    };
+
+    Section(const std::string& name, int id, Type type, unsigned int address)
+        : type(type), name(name), id(id), address(address), runSize(0) {}
 
     Type getType() const { return type; }
 
-    std::string getName() const { return name; }
+    const std::string& getName() const { return name; }
+
+    int getId() const { return id; }
+
+    // Encodes the statement at the end of the content and returns its
+    // offset among the encoded bytes. Nothing is stored for BSS sections,
+    // which can't hold data.
+    std::size_t addContent(const WritableData& statement) {
+        if (type == BSS) {
+            if (dynamic_cast<const WritableDirective&>(statement)
+                    .initialized()) {
+                throw DecodingException(
+                    "BSS section can only contain uninitalized data");
+            }
+            return content.size();
+        }
+        auto offset = content.size();
+        ByteWriter writer(content);
+        statement.write(writer);
+        return offset;
+    }
 
-    void addIstruction(const WritableData* instruction) {
-        if (type == BSS && dynamic_cast<const WritableDirective*>(instruction)
-                               ->initialized()) {
-            throw DecodingException(
-                "BSS section can only contain uninitalized data");
+    // Encodes the evaluated statement again over its previous bytes
+    void patchContent(std::size_t offset, const WritableData& statement) {
+        if (type != BSS) {
+            ByteWriter writer(content, offset);
+            statement.write(writer);
         }
-        instructions.push_back(instruction);
     }
 
+    // Appends length bytes of the value, as a run if it is long enough
+    void addFill(unsigned char byte, std::size_t length);
+
+    // Appends the bytes as a run without copying them, they must outlive
+    // the section
+    void addExternal(const unsigned char* data, std::size_t length);
+
+    // Content encoded by an earlier assembly
+    void setContent(const std::vector<unsigned char>& encoded,
+                    const std::vector<Run>& encodedRuns);
+
     void addRelocationData(const RelocationData& relData) {
         relocations.push_back(relData);
     }
@@ -40,15 +92,63 @@ class Section {
         return relocations.size() * 4;
     }
 
+    const std::vector<RelocationData>& getRelocations() const {
+        return relocations;
+    }
+
+    // Encoded bytes without the fills
+    const std::vector<unsigned char>& getContent() const { return content; }
+
+    const std::vector<Run>& getRuns() const { return runs; }
+
+    // Whether some run references bytes owned elsewhere
+    bool hasExternalRuns() const;
+
+    // Size of the whole content, encoded bytes and runs
+    std::size_t getContentSize() const { return content.size() + runSize; }
+
+    // Visits the content in order, calling bytes(begin, end) for every part
+    // of the encoded bytes and every external run, and fill(byte, length)
+    // for every fill
+    template <typename Bytes, typename Filler>
+    void forEachRun(Bytes bytes, Filler fill) const {
+        std::size_t encoded = 0;
+        std::size_t inRuns = 0;
+        for (auto&& r : runs) {
+            auto next = r.offset - inRuns;
+            bytes(content.data() + encoded, content.data() + next);
+            if (r.data) {
+                bytes(r.data, r.data + r.length);
+            } else {
+                fill(r.byte, r.length);
+            }
+            encoded = next;
+            inRuns += r.length;
+        }
+        bytes(content.data() + encoded, content.data() + content.size());
+    }
+
     const Section& writeRelData(std::ostream&) const;
     const Section& writeContent(std::ostream&) const;
 
+    // Text format of relocations and content, shared with the object file
+    // dumper
+    static void writeRelData(std::ostream&, const std::string& name,
+                             const RelocationData* begin,
+                             const RelocationData* end);
+    static void writeContent(std::ostream&, const std::string& name,
+                             const unsigned char* begin,
+                             const unsigned char* end);
+
    private:
     Type type;
     std::string name;
+    int id;
     unsigned int address;
 
-    std::vector<const WritableData*> instructions;
+    std::vector<unsigned char> content;
+    std::vector<Run> runs;
+    std::size_t runSize;
     std::vector<RelocationData> relocations;
 };
 
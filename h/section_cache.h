@@ -0,0 +1,81 @@
+#ifndef SECTION_CACHE_H_
+#define SECTION_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "data.h"
+#include "section.h"
+#include "token.h"
+
+// Encoded sections of one source file kept on disk between assemblies.
+// An entry is found by the hash of the section name, start address and
+// tokens. Its content and relocations are valid only while the symbols it
+// depends on keep the recorded values.
+class SectionCache {
+   public:
+    static const char MAGIC[4];
+    static const std::uint32_t VERSION;
+
+    // Label defined in the section, at an offset from its start
+    struct Label {
+        std::string name;
+        std::int32_t offset;
+    };
+
+    // Referenced symbol with the values the encoding was made with
+    struct Dependency {
+        std::string name;
+        std::int32_t address;
+        std::int32_t section;
+        std::uint32_t scope;
+        std::uint32_t number;
+    };
+
+    struct Entry {
+        std::uint64_t key;
+        // Start address, the relocation offsets are addresses
+        std::int32_t address;
+        std::uint32_t size;
+        std::int32_t sectionNumber;
+        std::vector<Label> labels;
+        std::vector<Dependency> dependencies;
+        std::vector<unsigned char> content;
+        // Fills only, sections with external runs aren't cached
+        std::vector<Section::Run> runs;
+        std::vector<RelocationData> relocations;
+    };
+
+    // Loads the cache of the source file from the directory. A missing or
+    // corrupted cache file is treated as an empty cache.
+    SectionCache(const std::string& directory,
+                 const std::string& sourceFileName);
+
+    SectionCache(const SectionCache&) = delete;
+    SectionCache& operator=(const SectionCache&) = delete;
+
+    static std::uint64_t hash(const std::string& sectionName, int address,
+                              const Token* begin, const Token* end);
+
+    // Loaded entry with the key, nullptr if there is none
+    const Entry* find(std::uint64_t key) const;
+
+    // Entries put since loading replace the whole cache file on save. A
+    // cache file that can't be written is left as it was.
+    void put(const Entry&);
+    void save() const;
+
+   private:
+    void load(const char* begin, const char* end);
+    // Throws SystemException unless the content, runs, labels and
+    // relocations of the entry fit its size
+    static void validate(const Entry&);
+
+    std::string fileName;
+    std::unordered_map<std::uint64_t, Entry> loaded;
+    std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SOURCE_BUFFER_H_
+#define SOURCE_BUFFER_H_
+
+#include <cstddef>
+#include <istream>
+#include <string>
+
+// Whole input file as one contiguous, read-only character range. Regular
+// files are memory mapped, anything else (pipes, terminals, stdin given as
+// "-") is read into an owned buffer.
+class SourceBuffer {
+   public:
+    static const std::string STDIN_NAME;
+
+    explicit SourceBuffer(const std::string& fileName);
+    explicit SourceBuffer(std::istream& input);
+
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer(SourceBuffer&&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(SourceBuffer&&) = delete;
+
+    const char* begin() const { return data; }
+
+    const char* end() const { return data + length; }
+
+    std::size_t size() const { return length; }
+
+    bool isMapped() const { return mapped; }
+
+    // Drops the mapped pages of a consumed range from memory, the range
+    // stays readable and is read from the file again if accessed. Does
+    // nothing for buffers that aren't mapped.
+    void release(const char* begin, const char* end) const;
+
+   private:
+    static const std::size_t READ_BLOCK_SIZE;
+
+    bool map(int fileDescriptor, const std::string& fileName);
+    void read(int fileDescriptor, const std::string& fileName);
+    void read(std::istream& input);
+
+    const char* data;
+    std::size_t length;
+    bool mapped;
+    std::string storage;
+};
+
+#endif
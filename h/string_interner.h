@@ -0,0 +1,36 @@
+#ifndef STRING_INTERNER_H_
+#define STRING_INTERNER_H_
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include "string_ref.h"
+
+// Maps every distinct name seen during one assembly to a dense integer id.
+class StringInterner {
+   public:
+    static const int NO_ID;
+
+    StringInterner() = default;
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    int intern(const StringRef& name);
+
+    int find(const StringRef& name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? NO_ID : it->second;
+    }
+
+    const std::string& getName(int id) const { return names[id]; }
+
+    int size() const { return names.size(); }
+
+   private:
+    // Deque keeps the stored names in place, so the map keys stay valid
+    std::deque<std::string> names;
+    std::unordered_map<StringRef, int, StringRefHash> ids;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef STRING_REF_H_
+#define STRING_REF_H_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Non-owning view of a character range. The referenced characters must
+// outlive the view, in practice they live in the SourceBuffer of the file
+// being assembled or in static storage.
+class StringRef {
+   public:
+    StringRef() : text(""), length(0) {}
+
+    StringRef(const char* text) : text(text), length(std::strlen(text)) {}
+
+    StringRef(const char* text, std::size_t length)
+        : text(text), length(length) {}
+
+    StringRef(const std::string& str) : text(str.data()), length(str.size()) {}
+
+    const char* data() const { return text; }
+
+    const char* begin() const { return text; }
+
+    const char* end() const { return text + length; }
+
+    std::size_t size() const { return length; }
+
+    bool empty() const { return length == 0; }
+
+    char operator[](std::size_t index) const { return text[index]; }
+
+    std::string str() const { return std::string(text, length); }
+
+    friend bool operator==(const StringRef& first, const StringRef& second) {
+        return first.length == second.length &&
+               std::memcmp(first.text, second.text, first.length) == 0;
+    }
+
+    friend bool operator!=(const StringRef& first, const StringRef& second) {
+        return !(first == second);
+    }
+
+    friend std::string operator+(const std::string& first,
+                                 const StringRef& second) {
+        return first + second.str();
+    }
+
+    friend std::string operator+(const char* first, const StringRef& second) {
+        return first + second.str();
+    }
+
+    friend std::string operator+(const StringRef& first,
+                                 const std::string& second) {
+        return first.str() + second;
+    }
+
+    friend std::string operator+(const StringRef& first, const char* second) {
+        return first.str() + second;
+    }
+
+   private:
+    const char* text;
+    std::size_t length;
+};
+
+// FNV-1a over the referenced characters
+struct StringRefHash {
+    std::size_t operator()(const StringRef& str) const {
+        std::size_t hash = 2166136261u;
+        for (auto c : str) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash;
+    }
+};
+
+#endif
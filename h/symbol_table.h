@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include "exceptions_a.h"
+#include "string_interner.h"
 #include "utils.h"
 
 class SymbolTable {
@@ -16,14 +17,16 @@ class SymbolTable {
 
     struct Symbol {
         std::string name;
+        int id;
         int section;
         Scope scope;
         int address;
         unsigned int number;
 
-        Symbol(const std::string& name, int section, Scope scope, int address,
-               unsigned int number)
+        Symbol(const std::string& name, int id, int section, Scope scope,
+               int address, unsigned int number)
             : name(name),
+              id(id),
               section(section),
               scope(scope),
               address(address),
@@ -32,48 +35,50 @@ class SymbolTable {
 
     struct Section {
         std::string name;
+        int id;
         int size;
         int number;
         unsigned int address;
         unsigned int relocationSectionSize;
 
-        Section(const std::string& name, unsigned int address,
+        Section(const std::string& name, int id, unsigned int address,
                 unsigned int number, int size)
             : name(name),
+              id(id),
               address(address),
               size(size),
               number(number),
               relocationSectionSize(0) {}
     };
 
-    SymbolTable() { lastSection = 0; }
-
-    void putSection(const std::string& name, unsigned int address);
-    void putSymbol(const std::string& name, int address, Scope scope = LOCAL,
-                   int section = -2);
+    // Symbols and sections are identified by their names interned in the
+    // given interner, which must outlive the table
+    explicit SymbolTable(const StringInterner& interner)
+        : interner(&interner) {
+        lastSection = 0;
+    }
 
-    bool updateScope(const std::string& name, Scope newScope);
-    bool symbolExists(const std::string& name) const;
-    bool sectionExists(const std::string& name) const;
+    void putSection(int id, unsigned int address);
+    void putSymbol(int id, int address, Scope scope = LOCAL, int section = -2);
 
-    const Symbol& getSymbol(const std::string&) const;
-    const Section& getSection(const std::string&) const;
+    bool updateScope(int id, Scope newScope);
+    bool symbolExists(int id) const;
+    bool sectionExists(int id) const;
 
-    const Section& getSection(unsigned int num) const {
-        if (num > sections.size()) {
-            throw SystemException("No section with number " +
-                                  Utils::convertToString(num));
-        }
-        return sections[num];
-    }
+    const Symbol& getSymbol(int id) const;
+    const Section& getSection(int id) const;
 
-    void updateSectionSize(const std::string& sectionName, int sectionSize);
-    void updateRelocationSectionSize(const std::string& sectionName,
+    void updateSectionSize(int sectionId, int sectionSize);
+    void updateRelocationSectionSize(int sectionId,
                                      unsigned int relocationSectionSize);
     int getCummulativeSectionSize() const;
 
     void setSymbolNumbers();
 
+    const std::vector<Symbol>& getSymbols() const { return symbols; }
+
+    const std::vector<Section>& getSections() const { return sections; }
+
     friend std::ostream& operator<<(std::ostream& os,
                                     const SymbolTable& symbolTable);
 
@@ -89,9 +94,28 @@ class SymbolTable {
         }
     }
 
+    static const int NO_INDEX;
+
+    // Index stored for the id, NO_INDEX if there is none
+    static int findIndex(const std::vector<int>& indexes, int id) {
+        return id >= 0 && id < int(indexes.size()) ? indexes[id] : NO_INDEX;
+    }
+
+    static int& getIndex(std::vector<int>& indexes, int id) {
+        if (id >= int(indexes.size())) {
+            indexes.resize(id + 1, NO_INDEX);
+        }
+        return indexes[id];
+    }
+
+    // Vectors keep the order of definition for the output, the indexes map
+    // interned ids to positions in them
     std::vector<Symbol> symbols;
     std::vector<Section> sections;
+    std::vector<int> symbolIndexes;
+    std::vector<int> sectionIndexes;
     int lastSection;
+    const StringInterner* interner;
 };
 
 #endif
\ No newline at end of file
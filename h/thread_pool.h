@@ -0,0 +1,71 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing submitted tasks. Every worker has
+// its own queue: tasks submitted from outside the pool are spread over the
+// queues round robin, tasks submitted by a worker go to its own queue. An
+// idle worker takes the newest task of its own queue, or steals the oldest
+// one from another queue. Exceptions thrown by a task are delivered through
+// its future.
+class ThreadPool {
+   public:
+    static const int NO_WORKER;
+
+    // Zero threads means one per hardware thread
+    explicit ThreadPool(int threadCount = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    std::future<void> submit(std::function<void()> task);
+
+    int size() const { return workers.size(); }
+
+    // Index of the calling worker in this pool, NO_WORKER if the caller
+    // isn't one of its workers
+    int workerIndex() const;
+
+    // Whether the caller is a worker of any pool. Work already running on
+    // a pool doesn't start pools of its own, which would oversubscribe the
+    // cores with nested workers.
+    static bool onWorker();
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::packaged_task<void()>> tasks;
+    };
+
+    // Pool and index of the worker running on the current thread
+    static thread_local const ThreadPool* currentPool;
+    static thread_local int currentWorker;
+
+    void work(int index);
+    bool take(int index, std::packaged_task<void()>& task);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<unsigned int> nextQueue;
+
+    // Guards the count of queued tasks idle workers sleep on
+    std::mutex tasksMutex;
+    std::condition_variable available;
+    int pending;
+    bool stopping;
+};
+
+#endif
@@ -1,10 +1,14 @@
 #ifndef TOKEN_H_
 #define TOKEN_H_
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 #include <vector>
 #include "exceptions_a.h"
+#include "string_ref.h"
+
+class TokenRange;
 
 class Token {
    public:
@@ -22,23 +26,36 @@ class Token {
         LINE_DELIMITER,
         LOCATION_VALUE_QUANT,
         ASCI_CHARACTER,
+        STRING,
         UNDEFINED
     };
 
-    Token(Type type, const std::string& value) : type(type), value(value) {}
+    static const int NO_ID;
+
+    // Value is a view into the source buffer, for strings the characters
+    // between the quotes with escape sequences as written. Data is the
+    // interned id of identifiers and labels, and the converted value of
+    // numbers and characters.
+    Token(Type type, const StringRef& value, int data = NO_ID)
+        : value(value), type(type), data(data) {}
 
     Type getType() const { return type; }
 
-    std::string getValue() const { return value; }
+    std::string getValue() const { return value.str(); }
+
+    const StringRef& getText() const { return value; }
+
+    int getId() const {
+        return type == IDENTIFICATOR || type == LABEL ? data : NO_ID;
+    }
 
     int getIntValue() const {
         switch (type) {
             case BIN_NUMBER:
-                return std::stoi(value, nullptr, 2);
             case HEX_NUMBER:
-                return std::stoi(value, nullptr, 16);
             case DEC_NUMBER:
-                return std::stoi(value, nullptr);
+            case ASCI_CHARACTER:
+                return data;
             default:
                 throw SystemException("Can't convert token of type " +
                                       getTypeDescription() + " to int");
@@ -73,6 +90,8 @@ class Token {
                 return "Location value quantificator (*)";
             case ASCI_CHARACTER:
                 return "Asci character";
+            case STRING:
+                return "String literal";
             case UNDEFINED:
                 return "Undefined token";
         }
@@ -83,13 +102,33 @@ class Token {
                firstToken.value == secondToken.value;
     }
 
-    static std::string joinTokens(const std::vector<Token>&);
+    static std::string joinTokens(const TokenRange&);
 
    private:
+    StringRef value;
     Type type;
-    std::string value;
+    int data;
 };
 
 const Token UNDEFINED_TOKEN = Token(Token::UNDEFINED, "");
 
+// Consecutive tokens of a TokenStream, e.g. the ones forming one operand
+class TokenRange {
+   public:
+    TokenRange(const Token* first, const Token* last)
+        : first(first), last(last) {}
+
+    const Token* begin() const { return first; }
+
+    const Token* end() const { return last; }
+
+    std::size_t size() const { return last - first; }
+
+    const Token& operator[](std::size_t index) const { return first[index]; }
+
+   private:
+    const Token* first;
+    const Token* last;
+};
+
 #endif
\ No newline at end of file
@@ -1,110 +1,273 @@
 #ifndef TOKENIZER_H_
 #define TOKENIZER_H_
 
-#include <fstream>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 #include "exceptions_a.h"
+#include "source_buffer.h"
+#include "string_interner.h"
+#include "string_ref.h"
+#include "thread_pool.h"
 #include "token.h"
 
-class Feeder {
+// Supplies the tokens of a stream one block at a time
+class TokenSource {
    public:
-    Feeder(const std::string& input) : input(input), currentIndex(0) {}
+    virtual ~TokenSource() = default;
 
-    char feed() {
-        if (currentIndex == input.size() || input[currentIndex] == ';' ||
-            input[currentIndex] == '\r') {
-            return 0;
-        }
-        auto nextCharacter = input[currentIndex];
-        currentIndex++;
-        return nextCharacter;
-    }
-
-   private:
-    std::string input;
-    int currentIndex;
+    // Appends the next block to tokens, false once the input is exhausted
+    virtual bool fill(std::vector<Token>& tokens) = 0;
 };
 
 class TokenStream {
    public:
-    TokenStream(const std::vector<Token>& tokens)
-        : tokens(tokens), currentIndex(0) {}
+    explicit TokenStream(std::vector<Token>&& tokens)
+        : tokens(std::move(tokens)), source(nullptr), currentIndex(0) {}
+
+    // Pulls the blocks from the source as they are consumed. Tokens of the
+    // previous block stay valid, so a token taken just before a pull can
+    // still be used.
+    explicit TokenStream(TokenSource& source)
+        : source(&source), currentIndex(0) {}
 
-    Token next() {
-        if (currentIndex >= tokens.size()) {
+    const Token& next() {
+        if (currentIndex >= tokens.size() && !pull()) {
             throw StreamException();
         }
         return tokens[currentIndex++];
     }
 
-    Token peek() const {
-        if (currentIndex >= tokens.size()) {
+    const Token& peek() {
+        if (currentIndex >= tokens.size() && !pull()) {
             throw StreamException();
         }
         return tokens[currentIndex];
     }
 
+    // Positions are only comparable within one block, which is the whole
+    // input unless the stream has a source
+
+    // Token that next() is going to return, or the end of the stream
+    const Token* position() const { return tokens.data() + currentIndex; }
+
+    const Token* endPosition() const { return tokens.data() + tokens.size(); }
+
+    // Continues from a position of this stream
+    void seek(const Token* token) { currentIndex = token - tokens.data(); }
+
     void reset() { currentIndex = 0; }
 
-    bool end() const { return currentIndex == tokens.size(); }
+    bool end() { return currentIndex >= tokens.size() && !pull(); }
 
    private:
+    // Replaces the current block with the next one of the source
+    bool pull();
+
     std::vector<Token> tokens;
+    std::vector<Token> previous;
+    TokenSource* source;
     int currentIndex;
 };
 
+// Produced tokens reference the parsed characters, so the input must outlive
+// them. Identifiers and labels are interned into the given interner.
 class Tokenizer {
    public:
+    explicit Tokenizer(StringInterner& interner) : interner(interner) {}
+
     std::vector<Token> parse(const std::string& input,
                              int lineNumber = 1) const;
 
-    std::vector<Token> parse(std::ifstream& input) const;
+    std::vector<Token> parse(const SourceBuffer& input) const;
+
+    // Tokenizes line aligned chunks of the input on the pool. Tokens, ids
+    // and the reported error are the same as the ones of parse(input).
+    std::vector<Token> parse(const SourceBuffer& input,
+                             ThreadPool& pool) const;
+
+    class Pipeline;
 
    private:
-    enum State {
-        HUNTING,
-        IDENTIFICATOR_DETECTION,
-        ZERO_DETECTED,
-        ONE_DETECTED,
-        DEC_NUMERIC_DETECTION,
-        HEX_NUMERIC_DETECTION,
-        BIN_NUMERIC_DETECTION,
-        BIN_NUMERIC_DETECTED,
-        CLOSED_BRACKETS_DETECTED,
-        ASCI_DETECTION,
-        LABEL_DETECTION
+    static const std::size_t MIN_CHUNK_SIZE;
+
+    // Part of the input tokenized by one task, with its own interner
+    struct Chunk {
+        Chunk(const char* begin, const char* end)
+            : begin(begin), end(end), lineNumber(1) {}
+
+        const char* begin;
+        const char* end;
+        int lineNumber;
+        StringInterner interner;
+        std::vector<Token> tokens;
+        std::exception_ptr error;
+    };
+
+    static std::deque<Chunk> split(const SourceBuffer& input, int count);
+
+    // Appends chunk tokens, replacing chunk ids with the ones of interner
+    void merge(Chunk& chunk, std::vector<Token>& tokens) const;
+
+    // Classes a character belongs to, looked up in a 256 entry table
+    enum CharacterClass {
+        BLANK = 1 << 0,
+        LINE_END = 1 << 1,
+        DECIMAL_DIGIT = 1 << 2,
+        HEX_DIGIT = 1 << 3,
+        BINARY_DIGIT = 1 << 4,
+        IDENTIFICATOR_PART = 1 << 5
     };
 
+    static const std::array<unsigned char, 256> characterClasses;
+    static std::array<unsigned char, 256> constructCharacterClasses();
+
+    static bool is(char character, CharacterClass characterClass) {
+        return characterClasses[static_cast<unsigned char>(character)] &
+               characterClass;
+    }
+
+    static bool isLineEnd(const char* current, const char* end) {
+        return current == end || is(*current, LINE_END);
+    }
+
+    // Whether the character can follow a number or an identificator
+    static bool isSeparator(char character, bool openBracketAllowed) {
+        return is(character, BLANK) || character == ',' || character == ']' ||
+               (character == '[' && openBracketAllowed);
+    }
+
+    // First character at or after current that is not of the given class
+    static const char* skip(const char* current, const char* end,
+                            CharacterClass characterClass);
+
+    static const char* skipLine(const char* current, const char* end);
+
+    // Mask of the 16 characters starting at current that are of the class
+    static int matching(const char* current, CharacterClass characterClass);
+
+    // Token together with the character that can't extend it
+    static std::string rejected(const char* tokenStart, const char* current,
+                                const char* end) {
+        return std::string(tokenStart,
+                           isLineEnd(current, end) ? current : current + 1);
+    }
+
+    static long long convert(const char* begin, const char* end, int base);
+
+    void scan(const char* begin, const char* end, int lineNumber,
+              std::vector<Token>& tokens) const;
+
+    const char* scanIdentificator(const char* tokenStart, const char* end,
+                                  int lineNumber,
+                                  std::vector<Token>& tokens) const;
+    const char* scanNumber(const char* tokenStart, const char* end,
+                           int lineNumber, std::vector<Token>& tokens) const;
+    const char* scanAsci(const char* quote, const char* end, int lineNumber,
+                         std::vector<Token>& tokens) const;
+    const char* scanString(const char* quote, const char* end,
+                           int lineNumber, std::vector<Token>& tokens) const;
+    const char* scanSeparator(const char* current, const char* end,
+                              const char* tokenStart, bool openBracketAllowed,
+                              int lineNumber,
+                              std::vector<Token>& tokens) const;
+    const char* scanClosedBrackets(const char* current, const char* end,
+                                   int lineNumber,
+                                   std::vector<Token>& tokens) const;
+
     Token createCharBasedToken(char) const;
 
-    Token createIdentificatorToken(const std::string& value) const {
-        return Token(Token::IDENTIFICATOR, value);
+    Token createNumberToken(Token::Type, const StringRef& text,
+                            long long value, int lineNumber) const;
+
+    Token createIdentificatorToken(const StringRef& value) const {
+        return Token(Token::IDENTIFICATOR, value, interner.intern(value));
     }
 
-    Token createDecimalNumberToken(const std::string& value) const {
-        return Token(Token::DEC_NUMBER, value);
+    Token createDecimalNumberToken(const StringRef& text, long long value,
+                                   int lineNumber) const {
+        return createNumberToken(Token::DEC_NUMBER, text, value, lineNumber);
     }
 
-    Token createHexNumberToken(const std::string& value) const {
-        return Token(Token::HEX_NUMBER, value);
+    Token createHexNumberToken(const StringRef& text, long long value,
+                               int lineNumber) const {
+        return createNumberToken(Token::HEX_NUMBER, text, value, lineNumber);
     }
 
-    Token createBinaryNumberToken(const std::string& value) const {
-        return Token(Token::BIN_NUMBER, value);
+    Token createBinaryNumberToken(const StringRef& text, long long value,
+                                  int lineNumber) const {
+        return createNumberToken(Token::BIN_NUMBER, text, value, lineNumber);
     }
 
-    Token createLabelToken(const std::string& value) const {
-        return Token(Token::LABEL, value);
+    Token createLabelToken(const StringRef& value) const {
+        return Token(Token::LABEL, value, interner.intern(value));
     }
 
     Token createNewLineToken() const {
         return Token(Token::LINE_DELIMITER, "\n");
     }
 
-    Token createAsciToken(const std::string& value) const {
-        return Token(Token::ASCI_CHARACTER, value);
+    Token createStringToken(const StringRef& value) const {
+        return Token(Token::STRING, value);
+    }
+
+    Token createAsciToken(const StringRef& value) const {
+        return Token(Token::ASCI_CHARACTER, value,
+                     value.empty() ? 0 : value[0]);
     }
+
+    StringInterner& interner;
+};
+
+// Tokenizes line aligned chunks of the input on the pool while earlier
+// ones are consumed, keeping at most a few chunks per worker in flight.
+// Blocks come in input order, with the ids and the error parse(input)
+// would give, and only the chunks in flight are held in memory.
+class Tokenizer::Pipeline : public TokenSource {
+   public:
+    Pipeline(const Tokenizer& tokenizer, const SourceBuffer& input,
+             ThreadPool& pool);
+
+    // Waits for the chunks in flight, their tasks reference them
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline& operator=(Pipeline&&) = delete;
+
+    bool fill(std::vector<Token>& tokens) override;
+
+    // Tokenizes the rest of the input dropping the tokens, so an invalid
+    // line after the consumed ones is still reported
+    void finish();
+
+   private:
+    static const int CHUNKS_PER_WORKER;
+
+    // Starts chunks until the limit is in flight or the input is split
+    void submit();
+
+    const Tokenizer& tokenizer;
+    const SourceBuffer& input;
+    ThreadPool& pool;
+    std::size_t capacity;
+    // Start of the input not split into chunks yet, and its line
+    const char* remaining;
+    int lineNumber;
+    // Start of the text the tokens of the last merged block reference,
+    // and the end of the text already released before it
+    const char* referenced;
+    const char* released;
+    std::deque<Chunk> chunks;
+    std::deque<std::future<void>> results;
+    std::exception_ptr error;
 };
 
 #endif
\ No newline at end of file
@@ -14,20 +14,5 @@ class Utils {
     }
 
     static std::string uppercaseString(const std::string&);
-
-    static int writeData(std::ostream&, unsigned int data, int size,
-                         int currentColumn);
-
-    static int writeInstruction(std::ostream&, unsigned int data, int size,
-                                int currentColumn);
-
-    static int writeByte(std::ostream& os, unsigned char d, int currentColumn) {
-        if (d < 0x0F) {
-            os << 0;
-        }
-        currentColumn += 2;
-        os << std::hex << int(d) << (currentColumn % 16 ? " " : "\n");
-        return currentColumn;
-    }
 };
 #endif
\ No newline at end of file
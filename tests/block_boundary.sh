@@ -0,0 +1,32 @@
+#!/bin/sh
+# Inputs of 1 MB and more are decoded in blocks of at least 64 KB ending
+# with the line that holds their last byte. An invalid instruction on that
+# line must be reported as it is in a small input.
+ASSEMBLER=${1:-./assembler.out}
+DIRECTORY=$(mktemp -d)
+trap 'rm -rf "$DIRECTORY"' EXIT
+
+awk 'BEGIN {
+    size = 6; print ".text"
+    line = "    add r1, r2                 "
+    while (size + 32 <= 65536 - 5) { print line; size += 32 }
+    printf "%" (65536 - 5 - size - 1) "s\n", ""; size = 65536 - 5
+    print "    add r1 r2"; size += 14
+    while (size < 1048576) { print "    mov r1, r2"; size += 15 }
+    print ".end"
+}' > "$DIRECTORY/large.txt"
+printf '.text\n    add r1 r2\n.end\n' > "$DIRECTORY/small.txt"
+
+"$ASSEMBLER" "$DIRECTORY/large.txt" "$DIRECTORY/large.obj" \
+    > "$DIRECTORY/large.log" 2>&1
+large=$?
+"$ASSEMBLER" "$DIRECTORY/small.txt" "$DIRECTORY/small.obj" \
+    > "$DIRECTORY/small.log" 2>&1
+small=$?
+if [ $large -ne $small ] ||
+    ! cmp -s "$DIRECTORY/large.log" "$DIRECTORY/small.log"; then
+    echo "block_boundary: FAILED"
+    cat "$DIRECTORY/large.log"
+    exit 1
+fi
+echo "block_boundary: OK"